@@ -9,7 +9,9 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include <stdio.h>
 #include <memory.h>
+#include <string.h>
 #include <stdlib.h>
+#include <time.h>
 #if _WIN32 || _WIN64
     #include <windows.h>
 #endif
@@ -18,13 +20,21 @@
 #else
     #define thread_local __thread
 #endif
+#include "perftest.h"
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+#ifdef __AVX2__
+    #include <immintrin.h>
+#endif
 
 
 // Always make X size the largest for faster solving.
 // A map of x*y*z = 10*5*3 solves fastest
-#define FIELD_X_SIZE 6
-#define FIELD_Y_SIZE 5
-#define FIELD_Z_SIZE 5
+// These are the defaults, Pento3dSetPuzzle can change the size and pieces.
+int FieldX = 6, FieldY = 5, FieldZ = 5;
+#define MAX_FIELD_SIZE 30
+#define MAX_PIECES 120  // Piece numbers go in the char map
 
 typedef struct {
     struct {
@@ -32,9 +42,7 @@ typedef struct {
     }cubes[6];
 }PieceList_t;
 
-#define   NUM_PIECES  (31)
-
-PieceList_t Pieces[NUM_PIECES] = {
+PieceList_t DefaultPieces[] = {
 
 //---------------------------------------------------------
 
@@ -81,6 +89,9 @@ PieceList_t Pieces[NUM_PIECES] = {
 
 };
 
+PieceList_t * Pieces = DefaultPieces;
+int NumPieces = sizeof(DefaultPieces)/sizeof(DefaultPieces[0]);
+
 
 
 
@@ -91,7 +102,7 @@ PieceList_t Pieces[NUM_PIECES] = {
 #define CU_TALL  4
 #define CU_DEPTH 2
 
-// Display text map size. 
+// Display text map size, at least this big, bigger for big fields.
 #define GRIDWIDTH 150
 #define GRIDHEIGHT 60
 
@@ -105,7 +116,9 @@ typedef int BOOL;
 //  |/
 //  +----> X
 
-static thread_local char CharGraph[GRIDHEIGHT][GRIDWIDTH];
+static thread_local char * CharGraph;
+static thread_local int GraphWidth, GraphHeight;
+#define GRAPH(row,col) CharGraph[(row)*GraphWidth+(col)]
 
 #define OMIT_LEFT_FRONT_EDGE 1
 #define OMIT_LEFT_TOP_EDGE 2
@@ -144,94 +157,112 @@ void PutCube(int x,int y,int z, int Omit, int CubeNum)
     }
 
     // Draw the corners of the front face.
-    CharGraph[up        ][across        ] = '+';
-    CharGraph[up        ][across+CU_WIDE] = '+';
-    CharGraph[up+CU_TALL][across+CU_WIDE] = '+';
-    CharGraph[up+CU_TALL][across        ] = '+';
+    GRAPH(up        , across        ) = '+';
+    GRAPH(up        , across+CU_WIDE) = '+';
+    GRAPH(up+CU_TALL, across+CU_WIDE) = '+';
+    GRAPH(up+CU_TALL, across        ) = '+';
 
     // Draw the back corners.
-    CharGraph[up+CU_DEPTH][        across+CU_DEPTH+CU_WIDE] = '+';
-    CharGraph[up+CU_DEPTH+CU_TALL][across+CU_DEPTH+CU_WIDE] = '+';
-    CharGraph[up+CU_DEPTH+CU_TALL][across+CU_DEPTH        ] = '+';
+    GRAPH(up+CU_DEPTH, across+CU_DEPTH+CU_WIDE) = '+';
+    GRAPH(up+CU_DEPTH+CU_TALL, across+CU_DEPTH+CU_WIDE) = '+';
+    GRAPH(up+CU_DEPTH+CU_TALL, across+CU_DEPTH        ) = '+';
 
 
     // Draw the horizontal lines.
     for (a=1;a<CU_WIDE;a++){
         if (Omit & OMIT_BOTTOM_FRONT_EDGE){
-            CharGraph[up][across+a] = SpaceChar;
+            GRAPH(up, across+a) = SpaceChar;
         }else{
-            CharGraph[up][across+a] = '-';
+            GRAPH(up, across+a) = '-';
         }
-        CharGraph[up+CU_TALL][across+a] = '-';
+        GRAPH(up+CU_TALL, across+a) = '-';
         if (Omit & OMIT_BACK_TOP_EDGE){
-            CharGraph[up+CU_TALL+CU_DEPTH][ across+CU_DEPTH+a] = SpaceChar;
+            GRAPH(up+CU_TALL+CU_DEPTH, across+CU_DEPTH+a) = SpaceChar;
         }else{
-            CharGraph[up+CU_TALL+CU_DEPTH][ across+CU_DEPTH+a] = '-';
+            GRAPH(up+CU_TALL+CU_DEPTH, across+CU_DEPTH+a) = '-';
         }
     }
 
     // Draw the vertical lines.
     for (a=1;a<CU_TALL;a++){
         if (Omit & OMIT_LEFT_FRONT_EDGE){
-            CharGraph[up+a][across] = SpaceChar;
+            GRAPH(up+a, across) = SpaceChar;
         }else{
-            CharGraph[up+a][across] = '|';
+            GRAPH(up+a, across) = '|';
         }
-        CharGraph[up+a][across+CU_WIDE] = '|';
+        GRAPH(up+a, across+CU_WIDE) = '|';
         if (Omit & OMIT_BACK_RIGHT_EDGE){
-            CharGraph[up+a+CU_DEPTH][ across+CU_WIDE+CU_DEPTH] = SpaceChar;
+            GRAPH(up+a+CU_DEPTH, across+CU_WIDE+CU_DEPTH) = SpaceChar;
         }else{
-            CharGraph[up+a+CU_DEPTH][ across+CU_WIDE+CU_DEPTH] = '|';
+            GRAPH(up+a+CU_DEPTH, across+CU_WIDE+CU_DEPTH) = '|';
         }
     }
 
     // Draw the lines extending back.
     for (a=1;a<CU_DEPTH;a++){
         if (Omit & OMIT_LEFT_TOP_EDGE){
-            CharGraph[up+CU_TALL+a][across+a] = SpaceChar;
+            GRAPH(up+CU_TALL+a, across+a) = SpaceChar;
         }else{
-            CharGraph[up+CU_TALL+a][across+a] = '/';
+            GRAPH(up+CU_TALL+a, across+a) = '/';
         }
-        CharGraph[up+CU_TALL+a][across+CU_WIDE+a] = '/';
+        GRAPH(up+CU_TALL+a, across+CU_WIDE+a) = '/';
         if (Omit & OMIT_BOTTOM_RIGHT_EDGE){
-            CharGraph[up+a][across+CU_WIDE+a] = SpaceChar;
+            GRAPH(up+a, across+CU_WIDE+a) = SpaceChar;
         }else{
-            CharGraph[up+a][across+CU_WIDE+a] = '/';
+            GRAPH(up+a, across+CU_WIDE+a) = '/';
         }
     }
 
     for (a=1;a<CU_TALL;a++){
         // Clear the front face.
         for (b=1;b<CU_WIDE;b++){
-            CharGraph[up+a][across+b] = SpaceChar;
+            GRAPH(up+a, across+b) = SpaceChar;
         }
         // Clear the right face.
         for (b=1;b<CU_DEPTH;b++){
-            CharGraph[up+a+b][across+CU_WIDE+b] = SpaceChar;
+            GRAPH(up+a+b, across+CU_WIDE+b) = SpaceChar;
         }
     }
     // Clear up top face.
     for (a=1;a<CU_DEPTH;a++){
         for (b=1;b<CU_WIDE;b++){ 
-            CharGraph[up+CU_TALL+a][across+a+b] = SpaceChar;
+            GRAPH(up+CU_TALL+a, across+a+b) = SpaceChar;
         }
     }
 
     // Label the piece.
     for (a=0;a<5;a++){
         if (Str[a] == 0) break;
-        CharGraph[up+CU_TALL/2][across+2+a] = Str[a];
-        CharGraph[up+CU_TALL+1][across+3+a] = Str[a];
+        GRAPH(up+CU_TALL/2, across+2+a) = Str[a];
+        GRAPH(up+CU_TALL+1, across+3+a) = Str[a];
     }
 
 }
 
 //-------------------------------------------------------------------------------
-// Initialize the display buffer.
+// Initialize the display buffer, for a map of the given size.
 //-------------------------------------------------------------------------------
-void InitGraph(void)
+void InitGraph(int SizeX, int SizeY, int SizeZ)
 {
-    memset(&CharGraph, ' ', sizeof(CharGraph));
+    // Room for the map, and at least for a piece shown front and back.
+    int Wide = SizeX > 11 ? SizeX : 11;
+    int Deep = SizeZ > 5 ? SizeZ : 5;
+    int Width = (Wide+1)*CU_WIDE + (Deep+1)*CU_DEPTH + 2;
+    int Height = ((SizeY > 5 ? SizeY : 5)+1)*CU_TALL + (Deep+1)*CU_DEPTH;
+    if (Width < GRIDWIDTH) Width = GRIDWIDTH;
+    if (Height < GRIDHEIGHT) Height = GRIDHEIGHT;
+
+    if (Width != GraphWidth || Height != GraphHeight){
+        free(CharGraph);
+        CharGraph = (char *)malloc(Width*Height);
+        if (!CharGraph){
+            printf("Failed to allocate display buffer\n");
+            exit(-1);
+        }
+        GraphWidth = Width;
+        GraphHeight = Height;
+    }
+    memset(CharGraph, ' ', GraphWidth*GraphHeight);
 }
 
 
@@ -241,18 +272,18 @@ void InitGraph(void)
 void PrintGraph(void)
 {
     int a,b;
-    for (a=GRIDHEIGHT;;){
+    for (a=GraphHeight;;){
         a--;
-        CharGraph[a][GRIDWIDTH-1] = '\0';
-        for (b=GRIDWIDTH-1;;){
+        GRAPH(a, GraphWidth-1) = '\0';
+        for (b=GraphWidth-1;;){
             b--;
-            if (CharGraph[a][b] != ' '){
+            if (GRAPH(a, b) != ' '){
                 break;
             }
             if (b == 0) goto no_line;
         }
-        CharGraph[a][b+1] = '\0';
-        puts(CharGraph[a]);
+        GRAPH(a, b+1) = '\0';
+        puts(&GRAPH(a, 0));
         no_line:
         if (a == 0) break;
     }
@@ -274,7 +305,7 @@ typedef struct {
 void Show3dMap(Map_3d_t Piece, BOOL ShowNums, int HilightedCube)
 {
     int x,y,z;
-    InitGraph();
+    InitGraph(Piece.x_max, Piece.y_max, Piece.z_max);
     for (z=Piece.z_max;;){
         z -= 1;
         for (y=0;y<Piece.y_max;y++){
@@ -330,15 +361,15 @@ typedef struct {
 //-------------------------------------------------------------------------------
 // Generate pice map from predefined stuff.
 //-------------------------------------------------------------------------------
-void ReadPiece(Map_t * Piece, int Index)
+void ReadPiece(Map_t * Piece, const PieceList_t * List)
 {
     int a;
     memset(Piece->Data, 0, 5*5*5);
     for (a=0;a<6;a++){
         int x,y,z;
-        x = Pieces[Index].cubes[a].x;
-        y = Pieces[Index].cubes[a].y;
-        z = Pieces[Index].cubes[a].z;
+        x = List->cubes[a].x;
+        y = List->cubes[a].y;
+        z = List->cubes[a].z;
         if (a < 5 || x || y || z){
             Piece->Data[x][y][z] = -1;
         }
@@ -579,6 +610,22 @@ struct {
 
 };
 
+typedef unsigned long long u64;
+
+// Bitboard layout: a bit per cube of the field map, guards included, in the
+// same order as the bytes of the map.  It only works for fields of up to
+// 256 cubes, like the default 7*6*6 = 252, so it fits in 4 words.  The
+// words after those are all ones, for reading past the end.
+#define BITS_WORDS 8
+#define BITS_CUBES 256
+
+// A wider fit mask, of the 64 cubes a piece can reach from its first cube.
+// The cubes are joined up and there are at most 5, so the others are at
+// most 4 steps away, and the first is the lowest in x, then y, then z, so
+// they all come after it.  Exactly 64 cubes are like that, so unlike the
+// 32 bit fit word, it's the whole fit test, not just a pre-check.
+#define AROUND_CUBES 64
+
 typedef struct {
     Map_t Orientations[24];
     int NumOrientations;
@@ -587,34 +634,434 @@ typedef struct {
         // Smallest Y and Z of first cube (that we try to fill)
         int YOffset, ZOffset;
          unsigned long FitWord;
+        // Cubes of the piece with the first cube at bit 0.  It's the lowest
+        // in x, then y, then z, so all the others come after it.
+        u64 Mask[4];
+        // The same cubes, as offsets into the field map from the first one.
+        short Cubes[5];
+        int NumCubes;
+        // And the ones other than the first, in the wide fit mask.
+        u64 Around;
     }FitOpt[24];
 }PieceData_t;
 
-thread_local PieceData_t AllPieces[NUM_PIECES];
+// For each cube of the field, the placements that fill it with their first
+// cube and stay inside the field, in the order the search tries them.  For
+// piece p, they're CellPlaces[CELL_START(T,cube)[p]] up to CELL_START(T,cube)[p+1].
+// That is all the search looks at, a few KB for each cube.
+typedef struct {
+    uint32_t FitWord;
+    unsigned char Orientation, NumOther;
+    short Other[4];   // Offsets of the other cubes from the one to fill.
+}CellPlace_t;
+
+// Everything worked out from the box and the pieces before searching.  Made
+// by MakeTables, and only read after that, so any number of searches, on
+// any number of threads, can share one.
+typedef struct {
+    // The puzzle it was made for.
+    int FieldX, FieldY, FieldZ;
+    const PieceList_t * Pieces;
+    int NumPieces;
+    int Variant;        // Order the pieces are tried in, see MakeTables
+
+    // The field map has a byte per cube, at x*XStride + y*YStride + z, with a
+    // plane of guard cubes past the end in x, y and z.  y and z need a guard
+    // on just one side, as running off the start of a row ends up in the
+    // guard of the row before, and x needs no lower bound.  After the last
+    // plane there are a few more planes of guards, for the fit word and
+    // CheckPlacement to read, and a few rows of them before the start, for
+    // the 64 cube fit mask on flat fields.  SetSizes works these out.
+    int XStride, YStride;
+    int MapCubes;       // Up to the end of the last guard plane
+    int MapBytes;       // With the extra guards at the end
+    int MapFront;       // Guards before the start
+    int FieldBytes;     // Of a whole Field_t, see below
+
+    PieceData_t * AllPieces;
+    int BitsUsable;     // Field fits the bitboard
+    int AroundOffset[AROUND_CUBES];  // Into the field map
+
+    CellPlace_t * CellPlaces;
+    u64 * CellMasks;    // Wide fit masks of the same placements
+    int NumCellPlaces;
+    int * CellStart;
+
+    // With symmetry breaking, how many symmetric solutions each one found
+    // stands for, and the piece restricted for it, or -1 if none.
+    int SymmetryOrder;
+    int SymmetryPiece;
+}PuzzleTables_t;
+
+#define CELL_START(T,cube) ((T)->CellStart + (cube)*((T)->NumPieces+1))
+
+//-------------------------------------------------------------------------------
+// Work out the strides and sizes of things from the field size.
+//-------------------------------------------------------------------------------
+static void SetSizes(PuzzleTables_t * T)
+{
+    T->YStride = T->FieldZ+1;
+    T->XStride = (T->FieldY+1)*T->YStride;
+    T->MapCubes = (T->FieldX+1)*T->XStride;
+    T->MapBytes = T->MapCubes + 4*T->XStride + 4*T->YStride + 4;
+    T->MapFront = 4*T->YStride + 4;
+    T->FieldBytes = BITS_WORDS*sizeof(u64) + T->MapFront + T->MapBytes + T->NumPieces;
+}
+
+//-------------------------------------------------------------------------------
+// realloc, for things the solver can't do without.
+//-------------------------------------------------------------------------------
+static void * MustRealloc(void * Old, size_t Bytes, const char * What)
+{
+    void * New = realloc(Old, Bytes);
+    if (!New){
+        printf("Failed to allocate %s\n", What);
+        exit(-1);
+    }
+    return New;
+}
+
+//-------------------------------------------------------------------------------
+// Work out the cubes of the wide fit mask, in order of x, y, z, and which
+// bit each one is, at AroundBit[x][y+4][z+4].
+//-------------------------------------------------------------------------------
+static void MakeAroundMap(PuzzleTables_t * T, signed char AroundBit[5][9][9])
+{
+    int x,y,z,n = 0;
+    memset(AroundBit, -1, 5*9*9);
+    for (x=0;x<=4;x++){
+        for (y=-4;y<=4;y++){
+            for (z=-4;z<=4;z++){
+                if (abs(x)+abs(y)+abs(z) > 4) continue;
+                if (x == 0 && (y < 0 || (y == 0 && z <= 0))) continue;
+                T->AroundOffset[n] = x*T->XStride + y*T->YStride + z;
+                AroundBit[x][y+4][z+4] = (signed char)n++;
+            }
+        }
+    }
+}
+//-------------------------------------------------------------------------------
+// Make the per cube placement lists.
+//-------------------------------------------------------------------------------
+static void MakeCellLists(PuzzleTables_t * T)
+{
+    int px,py,pz,a,b,n = 0, MaxPlaces = 0;
+
+    T->CellStart = (int *)MustRealloc(NULL,
+            T->MapCubes*(T->NumPieces+1)*sizeof(int), "placement lists");
+
+    memset(T->CellStart, 0, T->MapCubes*(T->NumPieces+1)*sizeof(int));
+    for (px=0;px<T->FieldX;px++){
+        for (py=0;py<T->FieldY;py++){
+            for (pz=0;pz<T->FieldZ;pz++){
+                int * Start = CELL_START(T,px*T->XStride+py*T->YStride+pz);
+                for (a=0;a<T->NumPieces;a++){
+                    Start[a] = n;
+                    for (b=0;b<T->AllPieces[a].NumOrientations;b++){
+                        Map_t * Map = &T->AllPieces[a].Orientations[b];
+                        int yp = py-T->AllPieces[a].FitOpt[b].YOffset;
+                        int zp = pz-T->AllPieces[a].FitOpt[b].ZOffset;
+                        int x,y,z,c;
+                        for (x=0;x<5;x++){
+                            for (y=0;y<5;y++){
+                                for (z=0;z<5;z++){
+                                    if (!Map->Data[x][y][z]) continue;
+                                    if (px+x >= T->FieldX
+                                        || yp+y < 0 || yp+y >= T->FieldY
+                                        || zp+z < 0 || zp+z >= T->FieldZ) goto outside;
+                                }
+                            }
+                        }
+                        if (n >= MaxPlaces){
+                            MaxPlaces = MaxPlaces ? MaxPlaces*2 : 4096;
+                            T->CellPlaces = (CellPlace_t *)MustRealloc(T->CellPlaces,
+                                    MaxPlaces*sizeof(CellPlace_t), "placement lists");
+                            T->CellMasks = (u64 *)MustRealloc(T->CellMasks,
+                                    MaxPlaces*sizeof(u64), "placement lists");
+                        }
+                        T->CellMasks[n] = T->AllPieces[a].FitOpt[b].Around;
+                        T->CellPlaces[n].FitWord = (uint32_t)T->AllPieces[a].FitOpt[b].FitWord;
+                        T->CellPlaces[n].Orientation = (unsigned char)b;
+                        T->CellPlaces[n].NumOther = (unsigned char)(T->AllPieces[a].FitOpt[b].NumCubes-1);
+                        for (c=1;c<T->AllPieces[a].FitOpt[b].NumCubes;c++){
+                            T->CellPlaces[n].Other[c-1] = T->AllPieces[a].FitOpt[b].Cubes[c];
+                        }
+                        n++;
+                        outside:;
+                    }
+                }
+                Start[T->NumPieces] = n;
+            }
+        }
+    }
+    T->NumCellPlaces = n;
+}
+
+//-------------------------------------------------------------------------------
+// Shuffle an array, with a little random number generator of our own so
+// every thread and every run gets the same order for the same seed.
+//-------------------------------------------------------------------------------
+static void Shuffle(void * Array, int Num, int Size, unsigned * Seed)
+{
+    char * a = (char *)Array;
+    char Temp[sizeof(Map_t)];
+    int n, k;
+    for (n=Num-1;n>0;n--){
+        *Seed = *Seed * 1103515245 + 12345;
+        k = (int)((*Seed >> 16) % (unsigned)(n+1));
+        memcpy(Temp, a+n*Size, Size);
+        memcpy(a+n*Size, a+k*Size, Size);
+        memcpy(a+k*Size, Temp, Size);
+    }
+}
+
+// A symmetry of the box, as which axis each coordinate comes from, and
+// whether it's flipped end for end.
+typedef struct {
+    int Axis[3];
+    int Flip[3];
+}BoxSym_t;
 
-thread_local int PlacementsTried = 0;
+//-------------------------------------------------------------------------------
+// Find the rotations of the box that map it onto itself, and the mirror
+// images too if Mirrors is set.  The first one is leaving it as it is.
+// Returns how many there are.
+//-------------------------------------------------------------------------------
+static int BoxSymmetries(const PuzzleTables_t * T, BoxSym_t * Syms, int Mirrors)
+{
+    static const int Perms[6][4] = { // Axes, and 1 if it's an odd permutation
+        {0,1,2,0}, {0,2,1,1}, {1,0,2,1}, {1,2,0,0}, {2,0,1,0}, {2,1,0,1}};
+    int Size[3];
+    int p, f, a, n = 0;
+
+    Size[0] = T->FieldX;
+    Size[1] = T->FieldY;
+    Size[2] = T->FieldZ;
+    for (p=0;p<6;p++){
+        int Odd;
+        for (a=0;a<3;a++) if (Size[Perms[p][a]] != Size[a]) break;
+        if (a < 3) continue;
+        for (f=0;f<8;f++){
+            // Each flip is a mirror image, as is swapping two axes.
+            Odd = Perms[p][3] ^ (f & 1) ^ ((f >> 1) & 1) ^ (f >> 2);
+            if (Odd && !Mirrors) continue;
+            for (a=0;a<3;a++){
+                Syms[n].Axis[a] = Perms[p][a];
+                Syms[n].Flip[a] = (f >> a) & 1;
+            }
+            n++;
+        }
+    }
+    return n;
+}
 
 //-------------------------------------------------------------------------------
-// Prepare 3d representations of all possible pieces in all orientations.
+// The orientation of a piece that comes first, to compare shapes.  With
+// Mirror set, of its mirror image.
 //-------------------------------------------------------------------------------
-void PreparePieces(void)
+static void CanonicalShape(const PuzzleTables_t * T, int PieceNum, int Mirror, Map_t * Shape)
 {
+    Map_t Ors[24], Piece;
+    int x,y,z,n,a;
+
+    Piece = T->AllPieces[PieceNum].Orientations[0];
+    if (Mirror){
+        for (x=0;x<5;x++){
+            for (y=0;y<5;y++){
+                for (z=0;z<5;z++){
+                    Piece.Data[x][y][z] = T->AllPieces[PieceNum].Orientations[0].Data[4-x][y][z];
+                }
+            }
+        }
+        MinimizeValues(&Piece);
+    }
+    n = UniqueOrientations(Ors, Piece);
+    *Shape = Ors[0];
+    for (a=1;a<n;a++){
+        if (memcmp(&Ors[a], Shape, sizeof(Map_t)) < 0) *Shape = Ors[a];
+    }
+}
+
+static int CompareShapes(const void * a, const void * b)
+{
+    return memcmp(a, b, sizeof(Map_t));
+}
+
+//-------------------------------------------------------------------------------
+// The cubes of a placement from the lists, after a symmetry of the box,
+// as sorted field map positions.  Returns how many.
+//-------------------------------------------------------------------------------
+static int PlacementKey(const PuzzleTables_t * T, int Pos, const CellPlace_t * Place, const BoxSym_t * Sym, int * Key)
+{
+    int Size[3];
+    int c, n, a, b;
+
+    Size[0] = T->FieldX;
+    Size[1] = T->FieldY;
+    Size[2] = T->FieldZ;
+    n = Place->NumOther+1;
+    for (c=0;c<n;c++){
+        int Cube = c ? Pos + Place->Other[c-1] : Pos;
+        int From[3], To[3];
+        From[0] = Cube / T->XStride;
+        From[1] = Cube % T->XStride / T->YStride;
+        From[2] = Cube % T->YStride;
+        for (a=0;a<3;a++){
+            To[a] = From[Sym->Axis[a]];
+            if (Sym->Flip[a]) To[a] = Size[a]-1-To[a];
+        }
+        Cube = To[0]*T->XStride + To[1]*T->YStride + To[2];
+        for (b=c;b>0 && Key[b-1] > Cube;b--) Key[b] = Key[b-1];
+        Key[b] = Cube;
+    }
+    return n;
+}
+
+//-------------------------------------------------------------------------------
+// Check that no symmetry of the box but the first maps any placement of the
+// piece onto itself.  With Keep, also take the placements out of the lists
+// that some symmetry maps to one that sorts before them, leaving one of
+// each set that are the same under the symmetries.
+//-------------------------------------------------------------------------------
+static int RestrictPiece(PuzzleTables_t * T, int PieceNum, const BoxSym_t * Syms, int NumSyms, int Keep)
+{
+    int px,py,pz,a,k,s,c,n = 0;
+
+    for (px=0;px<T->FieldX;px++){
+        for (py=0;py<T->FieldY;py++){
+            for (pz=0;pz<T->FieldZ;pz++){
+                int Pos = px*T->XStride+py*T->YStride+pz;
+                int * Start = CELL_START(T,Pos);
+                for (a=0;a<T->NumPieces;a++){
+                    int From = Start[a], To = Start[a+1];
+                    if (Keep) Start[a] = n;
+                    for (k=From;k<To;k++){
+                        if (a == PieceNum){
+                            int Key[5], Turned[5], NumCubes, Smallest = TRUE;
+                            NumCubes = PlacementKey(T, Pos, &T->CellPlaces[k], &Syms[0], Key);
+                            for (s=1;s<NumSyms;s++){
+                                PlacementKey(T, Pos, &T->CellPlaces[k], &Syms[s], Turned);
+                                for (c=0;c<NumCubes && Turned[c] == Key[c];c++);
+                                if (c >= NumCubes) return FALSE; // Maps onto itself
+                                if (Turned[c] < Key[c]) Smallest = FALSE;
+                            }
+                            if (!Smallest) continue;
+                        }
+                        if (Keep){
+                            T->CellPlaces[n] = T->CellPlaces[k];
+                            T->CellMasks[n] = T->CellMasks[k];
+                        }
+                        n++;
+                    }
+                }
+                if (Keep) Start[T->NumPieces] = n;
+            }
+        }
+    }
+    if (Keep) T->NumCellPlaces = n;
+    return TRUE;
+}
+
+//-------------------------------------------------------------------------------
+// Work out the symmetries of the box, and pick a piece to restrict so only
+// one of each set of symmetric solutions is found.  Mirror images only
+// count if the mirror image of each piece is also in the set, and the
+// piece restricted must then be its own mirror image.  If no piece will do
+// for all of them, try just the rotations.  It only works if every
+// solution has every piece, so the box must take all of them.
+//-------------------------------------------------------------------------------
+static void BreakSymmetry(PuzzleTables_t * T)
+{
+    BoxSym_t Syms[48];
+    Map_t * Shapes, * Mirrored;
+    int a, Mirrors, NumSyms, Cubes = 0, Closed;
+
+    for (a=0;a<T->NumPieces;a++) Cubes += T->AllPieces[a].FitOpt[0].NumCubes;
+    if (Cubes != T->FieldX*T->FieldY*T->FieldZ) return;
+
+    Shapes = (Map_t *)MustRealloc(NULL, 4*T->NumPieces*sizeof(Map_t), "shapes");
+    Mirrored = Shapes + T->NumPieces;
+    for (a=0;a<T->NumPieces;a++){
+        CanonicalShape(T, a, FALSE, &Shapes[a]);
+        CanonicalShape(T, a, TRUE, &Mirrored[a]);
+    }
+    // The set is its own mirror image if the sorted lists are the same.
+    memcpy(Shapes+2*T->NumPieces, Shapes, 2*T->NumPieces*sizeof(Map_t));
+    qsort(Shapes+2*T->NumPieces, T->NumPieces, sizeof(Map_t), CompareShapes);
+    qsort(Shapes+3*T->NumPieces, T->NumPieces, sizeof(Map_t), CompareShapes);
+    Closed = !memcmp(Shapes+2*T->NumPieces, Shapes+3*T->NumPieces, T->NumPieces*sizeof(Map_t));
+
+    for (Mirrors=Closed;Mirrors>=0 && T->SymmetryPiece < 0;Mirrors--){
+        NumSyms = BoxSymmetries(T, Syms, Mirrors);
+        if (NumSyms < 2) break;
+        for (a=0;a<T->NumPieces;a++){
+            if (Mirrors && memcmp(&Shapes[a], &Mirrored[a], sizeof(Map_t))) continue;
+            if (RestrictPiece(T, a, Syms, NumSyms, FALSE)){
+                RestrictPiece(T, a, Syms, NumSyms, TRUE);
+                T->SymmetryOrder = NumSyms;
+                T->SymmetryPiece = a;
+                break;
+            }
+        }
+    }
+    free(Shapes);
+}
+
+//-------------------------------------------------------------------------------
+// Prepare 3d representations of all possible pieces in all orientations, and
+// everything else the search needs, for a SizeX x SizeY x SizeZ box and Num
+// pieces from List.
+//
+// A Variant other than 0 shuffles the order the pieces and their orientations
+// are tried in, with it as the seed, for racing differently ordered searches
+// against each other.  With Symmetry set, placements of one piece are left
+// out so that only one of each set of solutions that are rotations or mirror
+// images of each other is found, by way of the placement lists.
+//-------------------------------------------------------------------------------
+PuzzleTables_t * MakePuzzleTables(int SizeX, int SizeY, int SizeZ, const PieceList_t * List,
+                                  int Num, int Variant, int Symmetry)
+{
+    PuzzleTables_t * T;
+    signed char AroundBit[5][9][9];  // Bit for x, y+4, z+4
     int a,b,c;
     int my,mz;
-
-    for (a=0;a<NUM_PIECES;a++){
+    int x,y,z;
+    int Order[MAX_PIECES];
+    unsigned Seed = (unsigned)Variant;
+
+    T = (PuzzleTables_t *)MustRealloc(NULL, sizeof(PuzzleTables_t), "tables");
+    memset(T, 0, sizeof(PuzzleTables_t));
+    T->FieldX = SizeX;
+    T->FieldY = SizeY;
+    T->FieldZ = SizeZ;
+    T->Pieces = List;
+    T->NumPieces = Num;
+    T->Variant = Variant;
+    SetSizes(T);
+    T->AllPieces = (PieceData_t *)MustRealloc(NULL, T->NumPieces*sizeof(PieceData_t), "pieces");
+    T->BitsUsable = T->MapCubes <= BITS_CUBES;
+    MakeAroundMap(T, AroundBit);
+
+    for (a=0;a<T->NumPieces;a++) Order[a] = a;
+    if (Variant) Shuffle(Order, T->NumPieces, sizeof(int), &Seed);
+
+    for (a=0;a<T->NumPieces;a++){
         Map_t Map;
-        ReadPiece(&Map, a);
+        ReadPiece(&Map, &T->Pieces[Order[a]]);
 
         // Make the unique orientations
-        AllPieces[a].NumOrientations = 
-            UniqueOrientations(AllPieces[a].Orientations, Map);
+        T->AllPieces[a].NumOrientations = 
+            UniqueOrientations(T->AllPieces[a].Orientations, Map);
+        if (Variant){
+            Shuffle(T->AllPieces[a].Orientations, T->AllPieces[a].NumOrientations, sizeof(Map_t), &Seed);
+        }
 
-        for (b=0;b<AllPieces[a].NumOrientations;b++){
+        for (b=0;b<T->AllPieces[a].NumOrientations;b++){
             // For each orientation, find the first ocupied cube in y and z.  This is the cube
             // that we will try to put into the next available position when solving.
             unsigned long FitWord;
-            Map = AllPieces[a].Orientations[b];
+            int TooBig = FALSE;
+            Map = T->AllPieces[a].Orientations[b];
 
             for (my=0;my<5;my++){
                 for (mz=0;mz<5;mz++){
@@ -624,8 +1071,8 @@ void PreparePieces(void)
             printf("Error! Empty piece\n");
             exit(-1);
             found:
-            AllPieces[a].FitOpt[b].YOffset = my;
-            AllPieces[a].FitOpt[b].ZOffset = mz;
+            T->AllPieces[a].FitOpt[b].YOffset = my;
+            T->AllPieces[a].FitOpt[b].ZOffset = mz;
 
             // For each orientation, fill the bitmap of occupied cubes relative to the handle piece.
             FitWord = 0;
@@ -640,9 +1087,57 @@ void PreparePieces(void)
                     FitWord |= (1<<c);
                 }
             }
-            AllPieces[a].FitOpt[b].FitWord = FitWord;
+            T->AllPieces[a].FitOpt[b].FitWord = FitWord;
+
+            memset(T->AllPieces[a].FitOpt[b].Mask, 0, sizeof(T->AllPieces[a].FitOpt[b].Mask));
+            T->AllPieces[a].FitOpt[b].NumCubes = 0;
+            T->AllPieces[a].FitOpt[b].Around = 0;
+            for (x=0;x<5;x++){
+                for (y=0;y<5;y++){
+                    for (z=0;z<5;z++){
+                        int Bit = x*T->XStride + (y-my)*T->YStride + z-mz;
+                        if (!Map.Data[x][y][z]) continue;
+                        if (x >= T->FieldX || y >= T->FieldY || z >= T->FieldZ) TooBig = TRUE;
+                        if (Bit >= 0 && Bit < BITS_CUBES){
+                            T->AllPieces[a].FitOpt[b].Mask[Bit >> 6] |= 1ULL << (Bit & 63);
+                        }
+                        T->AllPieces[a].FitOpt[b].Cubes[T->AllPieces[a].FitOpt[b].NumCubes++] = (short)Bit;
+                        if (x || y != my || z != mz){
+                            T->AllPieces[a].FitOpt[b].Around |= 1ULL << AroundBit[x][y-my+4][z-mz+4];
+                        }
+                    }
+                }
+            }
+            if (TooBig){
+                // Doesn't fit in the field this way round, so the mask may
+                // not even fit in the bitboard.  Make it one that never fits.
+                memset(T->AllPieces[a].FitOpt[b].Mask, 0xff, sizeof(T->AllPieces[a].FitOpt[b].Mask));
+            }
         }
     }
+    MakeCellLists(T);
+    T->SymmetryOrder = 1;
+    T->SymmetryPiece = -1;
+    if (Symmetry) BreakSymmetry(T);
+    return T;
+}
+
+//-------------------------------------------------------------------------------
+// Tables for the puzzle Pento3dSetPuzzle set up, or the default one.
+//-------------------------------------------------------------------------------
+PuzzleTables_t * MakeTables(int Variant, int Symmetry)
+{
+    return MakePuzzleTables(FieldX, FieldY, FieldZ, Pieces, NumPieces, Variant, Symmetry);
+}
+
+void FreeTables(PuzzleTables_t * T)
+{
+    if (!T) return;
+    free(T->AllPieces);
+    free(T->CellPlaces);
+    free(T->CellMasks);
+    free(T->CellStart);
+    free(T);
 }
 
 // generate empty field.
@@ -652,29 +1147,144 @@ void PreparePieces(void)
 
 
 
+// The field, as pointers into one block of T->FieldBytes: the bits, the map
+// with its guards, then IsUsed, so the whole thing copies with one memcpy.
 typedef struct {
-    char IsUsed[NUM_PIECES];
-    char Map[FIELD_X_SIZE+1][FIELD_Y_SIZE+1][FIELD_Z_SIZE+1]; 
-       // y and z require guard just one side (using array wrap around property)
-       // x requres no lower bound.
-
+    u64 * Bits;     // Same as Map, a bit per cube, for the bitboard search.
+    char * Map;     // Laid out as described at T->XStride
+    char * IsUsed;
 }Field_t;
 
+//-------------------------------------------------------------------------------
+// Point a field at its block, which must be T->FieldBytes long.
+//-------------------------------------------------------------------------------
+static void SetFieldBlock(const PuzzleTables_t * T, Field_t * Field, void * Block)
+{
+    Field->Bits = (u64 *)Block;
+    Field->Map = (char *)(Field->Bits + BITS_WORDS) + T->MapFront;
+    Field->IsUsed = Field->Map + T->MapBytes;
+}
+
+typedef struct {
+    int PieceNum;
+    int x,y,z;
+    int Orientation;
+}PlacedPos_t;
+
+// Instead of a copy of the field for each level, search with just the one
+// in Stages[0], and a log of the cubes each placement filled to take it
+// back off again.  Backing up to TryLevel takes off all the placements
+// after that one.  Only for finding the first solution.
+typedef struct {
+    int Start;      // First of its cubes in UndoCubes
+    int PieceNum;
+}UndoLevel_t;
+
+#define FIT_MAP   0   // CheckPlacement on the 5x5x5 maps
+#define FIT_BITS  1   // Bitboard
+#define FIT_LISTS 2   // Per cube placement lists
+#define FIT_WIDE  3   // Same lists, with the 64 cube fit mask
+
+// Set by whichever search in a race finds a solution first, so the others
+// can stop.  Each race has its own.
+#ifdef _MSC_VER
+    typedef volatile long RaceFlag_t;
+#else
+    typedef volatile int RaceFlag_t;
+#endif
+
+// A part of the search tree, for counting in parallel.
+typedef struct {
+    int NumPlaced;
+    int x,y,z;              // Cube to fill next
+    long long Solutions, Places;  // Results of searching it
+}CountTask_t;
+
+// The tasks a search with SplitDepth set cut the tree into.  The field for
+// task t is at Fields + t*T->FieldBytes.
+typedef struct {
+    CountTask_t * Tasks;
+    char * Fields;
+    int NumTasks, MaxTasks;
+}TaskList_t;
+
+// One search, and everything it changes as it goes.  The tables it reads
+// are shared, so each thread only needs one of these, a few KB, and any
+// number of them can search the same puzzle at once.  Made by NewSolver.
+typedef struct {
+    const PuzzleTables_t * T;
+
+    // How to search.
+    int FitMethod;
+    int UseUndoLog;
+    int CountAll;       // Counting all the solutions, see SolvePuzzle
+    int SplitDepth;     // If set, make counting tasks at this depth instead
+    TaskList_t * Split; // and put them here
+    RaceFlag_t * RaceOver;  // Race this search is in, if any
+
+    // Counting all the solutions instead of stopping at the first one.
+    // Backing up past pieces that don't let the target cube be filled can
+    // skip solutions, as a later piece could still fill it, so that's off
+    // for this.  Limits on the count, 0 for none.
+    long long CountMaxSolutions, CountMaxPlaces;
+    double CountDeadline;   // GetTimeSec() time to stop at
+
+    // Where to write checkpoints while counting, if anywhere, and how many
+    // seconds apart.
+    const char * CheckpointFile;
+    double CheckpointEvery;
+
+    Field_t * Stages;   // NumPieces+1 of them
+    char * StagesBlock; // Where their data is
+    PlacedPos_t * Placed;   // NumPieces of them
+    int NumPlaced;
+    int BackupTo;
+
+    int * UndoCubes;    // Up to 5 per piece
+    UndoLevel_t * UndoLevels;
+    int UndoTop;
+    int Applied;        // Placements currently on the field
+
+    // A count can run for hours, past what fits in an int.
+    long long PlacementsTried;
+    long long SearchNodes;
+    long long CountSolutions; // Also 1 when the first one was found
+    // For comparing the search state traffic of copying fields and of the
+    // undo log.  Bytes read plus bytes written.
+    double StateBytes;
+    // How many placements the fit words are tried on, and how many get past
+    // them, for seeing how much they filter out.
+    long long FitTests, FitPasses;
+
+    int ResumeDepth;    // Levels of the path still to place again
+    int ResumeX, ResumeY, ResumeZ;
+    double NextCheckpoint;  // GetTimeSec() time of the next one
+    int Checkpoints;    // Written, and time spent on them
+    double CheckpointSeconds;
+}Solver_t;
+
+static void CopyField(Solver_t * S, Field_t * Dest, const Field_t * Src)
+{
+    memcpy(Dest->Bits, Src->Bits, S->T->FieldBytes);
+    S->StateBytes += 2*S->T->FieldBytes;
+}
+
+
 
 //-------------------------------------------------------------------------------
 // Show the playing field.
 //-------------------------------------------------------------------------------
-void ShowMap(Field_t * Field, int HilightedCubenum)
+void ShowMap(const PuzzleTables_t * T, Field_t * Field, int HilightedCubenum)
 {
     Map_3d_t ShowData;
-    ShowData.Data = (char *)Field->Map;
+    ShowData.Data = Field->Map;
     ShowData.z_incr = 1;
-    ShowData.y_incr = FIELD_Z_SIZE+1;
-    ShowData.x_incr = (FIELD_Z_SIZE+1)*(FIELD_Y_SIZE+1);
+    ShowData.y_incr = T->YStride;
+    ShowData.x_incr = T->XStride;
 
-    ShowData.x_max = FIELD_X_SIZE;//+1;
-    ShowData.y_max = FIELD_Y_SIZE;//+1;
-    ShowData.z_max = FIELD_Z_SIZE;//+1;
+    ShowData.x_max = T->FieldX;//+1;
+    ShowData.y_max = T->FieldY;//+1;
+    ShowData.z_max = T->FieldZ;//+1;
 
     Show3dMap(ShowData, TRUE, HilightedCubenum);
 }
@@ -682,20 +1292,20 @@ void ShowMap(Field_t * Field, int HilightedCubenum)
 //-------------------------------------------------------------------------------
 // Show the playing field.
 //-------------------------------------------------------------------------------
-void ShowMap_Backside(Field_t * Field)
+void ShowMap_Backside(const PuzzleTables_t * T, Field_t * Field)
 {
     Map_3d_t ShowData;
-    ShowData.Data = ((char *)Field->Map) 
-        + 1                                   * (FIELD_Z_SIZE-1)
-        + (FIELD_Z_SIZE+1)                    *(FIELD_Y_SIZE-1);
+    ShowData.Data = Field->Map
+        + 1                                   * (T->FieldZ-1)
+        + T->YStride                          *(T->FieldY-1);
 
     ShowData.z_incr = -1;
-    ShowData.y_incr = -(FIELD_Z_SIZE+1);
-    ShowData.x_incr = (FIELD_Z_SIZE+1)*(FIELD_Y_SIZE+1);
+    ShowData.y_incr = -T->YStride;
+    ShowData.x_incr = T->XStride;
 
-    ShowData.x_max = FIELD_X_SIZE;//+1;
-    ShowData.y_max = FIELD_Y_SIZE;//+1;
-    ShowData.z_max = FIELD_Z_SIZE;//+1;
+    ShowData.x_max = T->FieldX;//+1;
+    ShowData.y_max = T->FieldY;//+1;
+    ShowData.z_max = T->FieldZ;//+1;
 
     Show3dMap(ShowData, TRUE, -1);
 }
@@ -703,14 +1313,14 @@ void ShowMap_Backside(Field_t * Field)
 //-------------------------------------------------------------------------------
 // Attempt to place a piece.  returns TRUE if successful.
 //-------------------------------------------------------------------------------
-int CheckPlacement(Field_t * Field, int xp, int yp, int zp, int PieceNum, int Orientation)
+int CheckPlacement(const PuzzleTables_t * T, Field_t * Field, int xp, int yp, int zp, int PieceNum, int Orientation)
 {
     Map_t * ThePiece;
     int x,y,z;
 
-    ThePiece = &AllPieces[PieceNum].Orientations[Orientation];
-    yp -= AllPieces[PieceNum].FitOpt[Orientation].YOffset;
-    zp -= AllPieces[PieceNum].FitOpt[Orientation].ZOffset;
+    ThePiece = &T->AllPieces[PieceNum].Orientations[Orientation];
+    yp -= T->AllPieces[PieceNum].FitOpt[Orientation].YOffset;
+    zp -= T->AllPieces[PieceNum].FitOpt[Orientation].ZOffset;
     if ( yp < 0 || zp < 0){
         //printf("went negative\n");
         return FALSE; // filling desired cube goes out of bounds.
@@ -719,7 +1329,7 @@ int CheckPlacement(Field_t * Field, int xp, int yp, int zp, int PieceNum, int Or
     for (x=0;x<5;x++){
         for (y=0;y<5;y++){
             for (z=0;z<5;z++){
-                if (Field->Map[x+xp][y+yp][z+zp] && ThePiece->Data[x][y][z]){
+                if (Field->Map[(x+xp)*T->XStride+(y+yp)*T->YStride+z+zp] && ThePiece->Data[x][y][z]){
                     // Interferes.
                     //printf("Interferes at %d,%d,%d\n",x,y,z);
                     return FALSE;
@@ -739,14 +1349,15 @@ int CheckPlacement(Field_t * Field, int xp, int yp, int zp, int PieceNum, int Or
 //-------------------------------------------------------------------------------
 // Attempt to place a piece.  returns TRUE if successful.
 //-------------------------------------------------------------------------------
-void PlacePiece(Field_t * Field, int xp, int yp, int zp, int PieceNum, int Orientation)
+void PlacePiece(Solver_t * S, Field_t * Field, int xp, int yp, int zp, int PieceNum, int Orientation)
 {
+    const PuzzleTables_t * T = S->T;
     Map_t * ThePiece;
     int x,y,z;
 
-    ThePiece = &AllPieces[PieceNum].Orientations[Orientation];
-    yp -= AllPieces[PieceNum].FitOpt[Orientation].YOffset;
-    zp -= AllPieces[PieceNum].FitOpt[Orientation].ZOffset;
+    ThePiece = &T->AllPieces[PieceNum].Orientations[Orientation];
+    yp -= T->AllPieces[PieceNum].FitOpt[Orientation].YOffset;
+    zp -= T->AllPieces[PieceNum].FitOpt[Orientation].ZOffset;
     if ( yp < 0 || zp < 0){
         printf("Error! went negative\n");
         exit(-1);
@@ -763,18 +1374,19 @@ void PlacePiece(Field_t * Field, int xp, int yp, int zp, int PieceNum, int Orien
         for (y=0;y<5;y++){
             for (z=0;z<5;z++){
                 if (ThePiece->Data[x][y][z]){
-                    if (Field->Map[x+xp][y+yp][z+zp]){
+                    char * Cube = &Field->Map[(x+xp)*T->XStride+(y+yp)*T->YStride+z+zp];
+                    if (*Cube){
                         printf("Placing piece with interference!");
                         exit(-1);
                     }
 
-                    Field->Map[x+xp][y+yp][z+zp] = PieceNum+1;
+                    *Cube = PieceNum+1;
                 }
             }
         }
     }
-    //if (NumPlaced > 31) printf("\nNumPlaced borked\n");
-    PlacementsTried += 1;
+    //if (S->NumPlaced > 31) printf("\nNumPlaced borked\n");
+    S->PlacementsTried += 1;
 }
 
 
@@ -782,7 +1394,7 @@ void PlacePiece(Field_t * Field, int xp, int yp, int zp, int PieceNum, int Orien
 //-------------------------------------------------------------------------------
 // Compute the fit word for fitting pre-checks.
 //-------------------------------------------------------------------------------
-unsigned long ComputeFitWord(Field_t * Field, int px,int py,int pz)
+unsigned long ComputeFitWord(const PuzzleTables_t * T, Field_t * Field, int px,int py,int pz)
 {
     int x,y,z,c;
     unsigned long FitWord = 0;
@@ -790,57 +1402,189 @@ unsigned long ComputeFitWord(Field_t * Field, int px,int py,int pz)
         x = FitMap[c].x+px;
         y = FitMap[c].y+py;
         z = FitMap[c].z+pz;
-        //if (x >= FIELD_X_SIZE) goto occupied;
-        //if (y < 0 || y >= FIELD_Y_SIZE) goto occupied;
-        //if (z < 0 || z >= FIELD_Z_SIZE) goto occupied;
-        if (Field->Map[x][y][z]){
+        //if (x >= FieldX) goto occupied;
+        //if (y < 0 || y >= FieldY) goto occupied;
+        //if (z < 0 || z >= FieldZ) goto occupied;
+        if (Field->Map[x*T->XStride+y*T->YStride+z]){
             FitWord |= (1<<c);
         }
     }
     return FitWord;
 }
 
-typedef struct {
-    int PieceNum;
-    int x,y,z;
-    int Orientation;
-}PlacedPos_t;
+//-------------------------------------------------------------------------------
+// Bitboard fit test, instead of CheckPlacement.  Shifts the field down so the
+// target cube is at bit 0 and ands it with the piece mask.  Placements that
+// go out of the field always run into a guard cube, as the pieces are joined
+// up, so there is no need to check the bounds.
+//-------------------------------------------------------------------------------
+static int LowestBit(u64 x)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#elif defined(_M_X64)
+    unsigned long n;
+    _BitScanForward64(&n, x);
+    return (int)n;
+#else
+    int n = 0;
+    while (!(x & 1)){
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static int CheckPlacementBits(Field_t * Field, int Pos, const u64 * Mask)
+{
+    const u64 * f = Field->Bits + (Pos >> 6);
+    int r = Pos & 63;
+#ifdef __AVX2__
+    // Only in AVX2 builds ("make AVX2=1"), the default build has no -mavx2.
+    // Shifts of 64 give zero here, so no special case for r == 0.
+    __m256i Lo = _mm256_loadu_si256((const __m256i *)f);
+    __m256i Hi = _mm256_loadu_si256((const __m256i *)(f+1));
+    __m256i Window = _mm256_or_si256(_mm256_srl_epi64(Lo, _mm_cvtsi32_si128(r)),
+                                     _mm256_sll_epi64(Hi, _mm_cvtsi32_si128(64-r)));
+    return _mm256_testz_si256(Window, _mm256_loadu_si256((const __m256i *)Mask));
+#else
+    if (r == 0){
+        return !((f[0] & Mask[0]) | (f[1] & Mask[1]) | (f[2] & Mask[2]) | (f[3] & Mask[3]));
+    }
+    return !((((f[0] >> r) | (f[1] << (64-r))) & Mask[0])
+           | (((f[1] >> r) | (f[2] << (64-r))) & Mask[1])
+           | (((f[2] >> r) | (f[3] << (64-r))) & Mask[2])
+           | (((f[3] >> r) | (f[4] << (64-r))) & Mask[3]));
+#endif
+}
+
+//-------------------------------------------------------------------------------
+// Place a piece in both the bitboard and the map.  The map is still used to
+// find the next empty cube and for the fit word.
+//-------------------------------------------------------------------------------
+static void PlacePieceBits(Solver_t * S, Field_t * Field, int Pos, int PieceNum, int Orientation)
+{
+    const u64 * Mask = S->T->AllPieces[PieceNum].FitOpt[Orientation].Mask;
+    char * Map = Field->Map + Pos;
+    int q = Pos >> 6, r = Pos & 63;
+    int w;
+
+    Field->IsUsed[PieceNum] = 1;
+    for (w=0;w<4;w++){
+        u64 m = Mask[w];
+        Field->Bits[q+w] |= m << r;
+        if (r) Field->Bits[q+w+1] |= m >> (64-r);
+        while (m){
+            int b = LowestBit(m);
+            Map[w*64+b] = (char)(PieceNum+1);
+            m &= m-1;
+        }
+    }
+    S->PlacementsTried += 1;
+}
+
+//-------------------------------------------------------------------------------
+// Fit test and placement for a placement from the per cube lists.  These are
+// all inside the field, so only the cubes of the piece need checking.
+//-------------------------------------------------------------------------------
+static int CheckPlacementCubes(Field_t * Field, int Pos, const CellPlace_t * Place)
+{
+    const char * Map = Field->Map + Pos;
+    int c;
+    for (c=0;c<Place->NumOther;c++){
+        if (Map[Place->Other[c]]) return FALSE;
+    }
+    return TRUE;
+}
+
+//-------------------------------------------------------------------------------
+// The cubes around the one to fill, as a wide fit mask.
+//-------------------------------------------------------------------------------
+static u64 ComputeAround(const PuzzleTables_t * T, Field_t * Field, int Pos)
+{
+    const char * Map = Field->Map + Pos;
+    u64 Around = 0;
+    int c;
+    for (c=0;c<AROUND_CUBES;c++){
+        Around |= (u64)(Map[T->AroundOffset[c]] != 0) << c;
+    }
+    return Around;
+}
+
+//-------------------------------------------------------------------------------
+// Test all the placements of a piece at once, against the cubes around the
+// one to fill.  There are at most 24, one per orientation.  Returns a bit
+// for each one that fits.
+//-------------------------------------------------------------------------------
+static uint32_t FitBatch(const u64 * Masks, int n, u64 Around)
+{
+    uint32_t Fits = 0;
+    int k = 0;
+#ifdef __AVX2__
+    // Four at a time.  Only in AVX2 builds ("make AVX2=1").
+    __m256i a = _mm256_set1_epi64x((long long)Around);
+    __m256i Zero = _mm256_setzero_si256();
+    for (;k+4<=n;k+=4){
+        __m256i Hit = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(Masks+k)), a);
+        __m256i Free = _mm256_cmpeq_epi64(Hit, Zero);
+        Fits |= (uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(Free)) << k;
+    }
+#endif
+    for (;k<n;k++){
+        Fits |= (uint32_t)((Masks[k] & Around) == 0) << k;
+    }
+    return Fits;
+}
+
+static void PlacePieceCubes(Solver_t * S, Field_t * Field, int Pos, int PieceNum, const CellPlace_t * Place)
+{
+    char * Map = Field->Map + Pos;
+    int c;
 
-thread_local PlacedPos_t Placed[NUM_PIECES+100];
-thread_local int NumPlaced;
+    Field->IsUsed[PieceNum] = 1;
+    Map[0] = (char)(PieceNum+1);
+    for (c=0;c<Place->NumOther;c++){
+        Map[Place->Other[c]] = (char)(PieceNum+1);
+    }
+    S->PlacementsTried += 1;
+}
 
 //-------------------------------------------------------------------------------
 // Show the puzzle solution.
 //-------------------------------------------------------------------------------
-void ShowSolution(Field_t * Field)
+void ShowSolution(Solver_t * S, Field_t * Field)
 {
-    int Distance[NUM_PIECES];
+    const PuzzleTables_t * T = S->T;
+    int * Distance;
     
     #ifdef TEST_MODULE
     return;
     #endif
+    Distance = (int *)MustRealloc(NULL, T->NumPieces*sizeof(int), "distances");
     
     printf("\nA solution:\nFront:\n");
   
-    ShowMap(Field, -1);
+    ShowMap(T, Field, -1);
  
     printf("Back:\n");
-    ShowMap_Backside(Field);
+    ShowMap_Backside(T, Field);
 
 
     // Determine order of pieces for best visibility in solution display
     {
         int x,y,z,a;
-        for (a=0;a<NUM_PIECES;a++){
+        for (a=0;a<T->NumPieces;a++){
             Distance[a] = 10000;
         }
 
-        for (x=0;x<FIELD_X_SIZE;x++){
-            for (y=0;y<FIELD_Y_SIZE;y++){
-                for (z=0;z<FIELD_Z_SIZE;z++){
+        for (x=0;x<T->FieldX;x++){
+            for (y=0;y<T->FieldY;y++){
+                for (z=0;z<T->FieldZ;z++){
                     int ViewerDistance, PieceNum;
                     ViewerDistance = 200-x*1-y*3+z*1;
-                    PieceNum = Field->Map[x][y][z]-1;
+                    PieceNum = Field->Map[x*T->XStride+y*T->YStride+z]-1;
+                    if (PieceNum < 0) continue; // Left empty, more room than pieces
                     if (Distance[PieceNum] > ViewerDistance){
                         Distance[PieceNum] = ViewerDistance;
                     }
@@ -848,89 +1592,320 @@ void ShowSolution(Field_t * Field)
             }
         }
 
-        for (a=0;a<NumPlaced;a++){                                        
-            //printf("piece %d distance %d\n",Placed[a].PieceNum, Distance[Placed[a].PieceNum]);
+        for (a=0;a<S->NumPlaced;a++){                                        
+            //printf("piece %d distance %d\n",S->Placed[a].PieceNum, Distance[S->Placed[a].PieceNum]);
         }
     }
 
     // Sort the pieces of the solution by distance to viewer, starting with furthest
     {
         int a,b,Furthest, FurthestIndex;
-        for (a=0;a<NumPlaced;a++){
+        for (a=0;a<S->NumPlaced;a++){
             PlacedPos_t Temp;
             Furthest = -10000;
-            for (b=a;b<NumPlaced;b++){
+            for (b=a;b<S->NumPlaced;b++){
                 int Dist;
-                Dist = Distance[(int)Placed[b].PieceNum];
+                Dist = Distance[(int)S->Placed[b].PieceNum];
                 if (Dist > Furthest){
                     Furthest = Dist;
                     FurthestIndex = b;
                 }
             }
             // Swap.
-            Temp = Placed[a];
-            Placed[a] = Placed[FurthestIndex];
-            Placed[FurthestIndex] = Temp;
+            Temp = S->Placed[a];
+            S->Placed[a] = S->Placed[FurthestIndex];
+            S->Placed[FurthestIndex] = Temp;
         }
     }
 
     {
         Field_t Field;
         int a;
-        memset(&Field, 0, sizeof(Field));
-        for (a=0;a<NumPlaced;a++){
+        SetFieldBlock(T, &Field, MustRealloc(NULL, T->FieldBytes, "field"));
+        memset(Field.Bits, 0, T->FieldBytes);
+        for (a=0;a<S->NumPlaced;a++){
             PlacedPos_t p;
-            p = Placed[a];
+            p = S->Placed[a];
             printf("\n\n");
             printf("Piece %d\n",p.PieceNum);
-            Show5(&AllPieces[p.PieceNum].Orientations[p.Orientation]);
-            PlacePiece(&Field, p.x,p.y,p.z,p.PieceNum,p.Orientation);
-            ShowMap(&Field, p.PieceNum+1);
+            Show5(&T->AllPieces[p.PieceNum].Orientations[p.Orientation]);
+            PlacePiece(S, &Field, p.x,p.y,p.z,p.PieceNum,p.Orientation);
+            ShowMap(T, &Field, p.PieceNum+1);
+        }
+        free(Field.Bits);
+    }
+    free(Distance);
+}
+
+//-------------------------------------------------------------------------------
+// Log the cubes of a placement just made at level S->NumPlaced.
+//-------------------------------------------------------------------------------
+static void LogPlacement(Solver_t * S, int Pos, int PieceNum, int Orientation)
+{
+    const short * Cubes = S->T->AllPieces[PieceNum].FitOpt[Orientation].Cubes;
+    int NumCubes = S->T->AllPieces[PieceNum].FitOpt[Orientation].NumCubes;
+    int c;
+
+    S->UndoLevels[S->NumPlaced].Start = S->UndoTop;
+    S->UndoLevels[S->NumPlaced].PieceNum = PieceNum;
+    for (c=0;c<NumCubes;c++){
+        S->UndoCubes[S->UndoTop++] = Pos + Cubes[c];
+    }
+    S->Applied = S->NumPlaced+1;
+    S->StateBytes += sizeof(UndoLevel_t) + NumCubes*sizeof(int);
+}
+
+//-------------------------------------------------------------------------------
+// Take placements back off the field, down to the given level.
+//-------------------------------------------------------------------------------
+static void RewindTo(Solver_t * S, Field_t * Field, int Level)
+{
+    while (S->Applied > Level){
+        UndoLevel_t * u = &S->UndoLevels[--S->Applied];
+        int NumCubes = S->UndoTop - u->Start;
+        S->StateBytes += sizeof(UndoLevel_t) + 1 + NumCubes*(sizeof(int)+1);
+        if (S->FitMethod == FIT_BITS){
+            int c;
+            for (c=u->Start;c<S->UndoTop;c++){
+                int Cube = S->UndoCubes[c];
+                Field->Bits[Cube >> 6] &= ~(1ULL << (Cube & 63));
+            }
+            S->StateBytes += NumCubes*2*sizeof(u64);
         }
+        while (S->UndoTop > u->Start){
+            Field->Map[S->UndoCubes[--S->UndoTop]] = 0;
+        }
+        Field->IsUsed[u->PieceNum] = 0;
     }
 }
 
-thread_local Field_t Stages[NUM_PIECES+1];
-thread_local int BackupTo;
+// Checkpoints, so a long count can be stopped and picked up again later.
+// The file has the pieces placed on the way to the node the search was
+// about to go into, and the counts up to there.  Everything before that
+// node in the search order has been counted.  Resuming places the same
+// pieces again, skipping what came before them at each level, and goes on
+// from that node.  Only for counting on one thread.
+typedef struct {
+    char Magic[8];
+    int FieldX, FieldY, FieldZ, NumPieces, PieceVariant, SymmetryOrder;
+    int NumPlaced;
+    int x,y,z;              // Cube the search was going on from
+    long long Solutions, Places;  // Counts up to there
+}Checkpoint_t;
+#define CHECKPOINT_MAGIC "3DPENTO3"
+
+//-------------------------------------------------------------------------------
+// Write the search position at node entry.  Goes to a temporary file first,
+// so getting killed while writing leaves the last one intact.
+//-------------------------------------------------------------------------------
+static void WriteCheckpoint(Solver_t * S, int px, int py, int pz)
+{
+    const PuzzleTables_t * T = S->T;
+    double Start = GetTimeSec();
+    Checkpoint_t Ck;
+    char * TempName;
+    FILE * f;
+    int Ok;
+
+    memset(&Ck, 0, sizeof(Ck));
+    memcpy(Ck.Magic, CHECKPOINT_MAGIC, sizeof(Ck.Magic));
+    Ck.FieldX = T->FieldX;
+    Ck.FieldY = T->FieldY;
+    Ck.FieldZ = T->FieldZ;
+    Ck.NumPieces = T->NumPieces;
+    Ck.PieceVariant = T->Variant;
+    Ck.SymmetryOrder = T->SymmetryOrder;
+    Ck.NumPlaced = S->NumPlaced;
+    Ck.x = px;
+    Ck.y = py;
+    Ck.z = pz;
+    Ck.Solutions = S->CountSolutions;
+    Ck.Places = S->PlacementsTried;
+
+    TempName = (char *)MustRealloc(NULL, strlen(S->CheckpointFile)+5, "file name");
+    sprintf(TempName, "%s.tmp", S->CheckpointFile);
+    f = fopen(TempName, "wb");
+    Ok = f != NULL;
+    if (f){
+        Ok = fwrite(&Ck, sizeof(Ck), 1, f) == 1;
+        if (S->NumPlaced) Ok &= fwrite(S->Placed, S->NumPlaced*sizeof(PlacedPos_t), 1, f) == 1;
+        Ok &= fclose(f) == 0;
+    }
+    if (Ok){
+        remove(S->CheckpointFile); // Windows won't rename over it.
+        Ok = rename(TempName, S->CheckpointFile) == 0;
+    }
+    if (!Ok) printf("Couldn't write checkpoint %s\n", S->CheckpointFile);
+    free(TempName);
+
+    S->Checkpoints += 1;
+    S->NextCheckpoint = GetTimeSec() + S->CheckpointEvery;
+    S->CheckpointSeconds += GetTimeSec()-Start;
+}
+
+//-------------------------------------------------------------------------------
+// Set up to resume from a checkpoint, after InitEmtpyField.  The search
+// must then be started from the top.  Returns FALSE if it can't be read,
+// or was for a different puzzle.
+//-------------------------------------------------------------------------------
+static int ReadCheckpoint(Solver_t * S, const char * Name)
+{
+    const PuzzleTables_t * T = S->T;
+    Checkpoint_t Ck;
+    FILE * f = fopen(Name, "rb");
+    int Ok, a;
+
+    if (!f){
+        printf("Can't open checkpoint %s\n", Name);
+        return FALSE;
+    }
+    Ok = fread(&Ck, sizeof(Ck), 1, f) == 1 && !memcmp(Ck.Magic, CHECKPOINT_MAGIC, sizeof(Ck.Magic))
+      && Ck.NumPlaced >= 0 && Ck.NumPlaced <= T->NumPieces
+      && (!Ck.NumPlaced || fread(S->Placed, Ck.NumPlaced*sizeof(PlacedPos_t), 1, f) == 1);
+    fclose(f);
+    for (a=0;Ok && a<Ck.NumPlaced;a++){
+        Ok = S->Placed[a].PieceNum >= 0 && S->Placed[a].PieceNum < T->NumPieces
+          && S->Placed[a].Orientation >= 0
+          && S->Placed[a].Orientation < T->AllPieces[S->Placed[a].PieceNum].NumOrientations;
+    }
+    if (!Ok){
+        printf("Checkpoint %s is no good\n", Name);
+        return FALSE;
+    }
+    if (Ck.FieldX != T->FieldX || Ck.FieldY != T->FieldY || Ck.FieldZ != T->FieldZ
+            || Ck.NumPieces != T->NumPieces || Ck.PieceVariant != T->Variant
+            || Ck.SymmetryOrder != T->SymmetryOrder){
+        printf("Checkpoint %s is for a different puzzle\n", Name);
+        return FALSE;
+    }
+
+    S->ResumeDepth = Ck.NumPlaced;
+    S->ResumeX = Ck.x;
+    S->ResumeY = Ck.y;
+    S->ResumeZ = Ck.z;
+    S->CountSolutions = Ck.Solutions;
+    // Placing the path again counts those placements a second time.
+    S->PlacementsTried = Ck.Places - Ck.NumPlaced;
+    return TRUE;
+}
+
+//-------------------------------------------------------------------------------
+// Called with each solution.  Returns TRUE if the search should stop.
+//-------------------------------------------------------------------------------
+static int SolutionFound(Solver_t * S, Field_t * Field)
+{
+    S->CountSolutions += 1;
+    if (!S->CountAll){
+        ShowSolution(S, Field);
+        return TRUE;
+    }
+    return S->CountMaxSolutions && S->CountSolutions >= S->CountMaxSolutions;
+}
+
+//-------------------------------------------------------------------------------
+// In count mode, whether to skip searching below a node.  Either it's at the
+// depth where the tree is cut into tasks, or a limit has been reached.
+//-------------------------------------------------------------------------------
+static int CountSkip(Solver_t * S, Field_t * Field, int px, int py, int pz)
+{
+    const PuzzleTables_t * T = S->T;
+    if (S->ResumeDepth){
+        if (S->NumPlaced < S->ResumeDepth) return FALSE; // Still placing the path
+        // Got back to where the checkpoint was, carry on normally from here.
+        if (px != S->ResumeX || py != S->ResumeY || pz != S->ResumeZ){
+            printf("Resumed search doesn't match the checkpoint\n");
+        }
+        S->ResumeDepth = 0;
+    }
+
+    if (S->SplitDepth && S->NumPlaced == S->SplitDepth){
+        TaskList_t * L = S->Split;
+        if (L->NumTasks >= L->MaxTasks){
+            L->MaxTasks = L->MaxTasks ? L->MaxTasks*2 : 1024;
+            L->Tasks = (CountTask_t *)MustRealloc(L->Tasks, L->MaxTasks*sizeof(CountTask_t), "tasks");
+            L->Fields = (char *)MustRealloc(L->Fields, (size_t)L->MaxTasks*T->FieldBytes, "tasks");
+        }
+        memcpy(L->Fields + (size_t)L->NumTasks*T->FieldBytes, Field->Bits, T->FieldBytes);
+        L->Tasks[L->NumTasks].NumPlaced = S->NumPlaced;
+        L->Tasks[L->NumTasks].x = px;
+        L->Tasks[L->NumTasks].y = py;
+        L->Tasks[L->NumTasks].z = pz;
+        L->NumTasks += 1;
+        return TRUE;
+    }
+
+    if ((S->CountMaxPlaces && S->PlacementsTried >= S->CountMaxPlaces)
+            || (S->CountDeadline && (S->PlacementsTried & 0xfff) == 0 && GetTimeSec() >= S->CountDeadline)){
+        // Stopped here, so that's where to resume.
+        if (S->CheckpointFile) WriteCheckpoint(S, px, py, pz);
+        S->BackupTo = -1; // Back all the way out.
+        return TRUE;
+    }
+    if (S->CheckpointFile && (S->PlacementsTried & 0xfff) == 0 && GetTimeSec() >= S->NextCheckpoint){
+        WriteCheckpoint(S, px, py, pz);
+    }
+    return FALSE;
+}
 
 //-------------------------------------------------------------------------------
 // Recursive puzzle solving...
 //-------------------------------------------------------------------------------
-void SolvePuzzle(int px,int py,int pz)
+void SolvePuzzle(Solver_t * S, int px,int py,int pz)
 {
+    // The field stores are chars, which could alias anything, so keep what
+    // doesn't change in locals rather than reading it through S each time.
+    const PuzzleTables_t * T = S->T;
+    const int FitMethod = S->FitMethod;
+    const int UseUndoLog = S->UseUndoLog;
+    const int CountAll = S->CountAll;
     Field_t * Field;
-    Field = &Stages[NumPlaced];
-    
+    Field = &S->Stages[UseUndoLog ? 0 : S->NumPlaced];
+    if (S->RaceOver && *S->RaceOver){
+        S->BackupTo = -1; // Someone else got there first.
+        return;
+    }
+    if (CountAll && CountSkip(S, Field, px,py,pz)) return;
+    S->SearchNodes += 1;
+    STATS_ENTER(S->NumPlaced < MAX_STATS_DEPTH ? S->NumPlaced : MAX_STATS_DEPTH-1);
     
-    if (NumPlaced == NUM_PIECES){
+    if (S->NumPlaced == T->NumPieces){
         // All placed is solved even if we have space left over.
-        ShowSolution(Field);
-        BackupTo = -1; // Don't look for more solution, just back out of recursion
+        if (SolutionFound(S, Field)){
+            S->BackupTo = -1; // Don't look for more solution, just back out of recursion
+        }
+        STATS_LEAVE();
         return;
     }
    
 
-    Stages[NumPlaced+1] = Stages[NumPlaced];
+    if (!UseUndoLog) CopyField(S, &S->Stages[S->NumPlaced+1], &S->Stages[S->NumPlaced]);
 
     // Find next empty cube.
-    while (Field->Map[px][py][pz]){
-        if (py & 1){
+    while (Field->Map[px*T->XStride+py*T->YStride+pz]){
+        if ((py & 1) && !CountAll){
             // Odd rows go backwards to improve locality & immediacy of undo.
+            // That can leave empty cubes before the one to fill in the same
+            // row, which only pieces placed from those cubes could fill, so
+            // some solutions never get tried.  Fine for finding one, but
+            // counting them goes straight along.
             if (pz <= 0) goto next_y;
             pz -= 1;
         }else{
-            if (pz >= (FIELD_Z_SIZE-1)){
+            if (pz >= (T->FieldZ-1)){
                 next_y:
                 py += 1;
-                if (py > FIELD_Y_SIZE){
+                if (CountAll) pz = 0;
+                if (py > T->FieldY){
                     py = 0;
                     pz = 0; // Must reset z for odd sizes of Y.
                     px++;
-                    if (px >= FIELD_X_SIZE){
+                    if (px >= T->FieldX){
                         // All positions filled is solved
                         // even if we have pieces left over.
-                        ShowSolution(Field);
-                        BackupTo = -1; // Don't look for more solutions, just back out
+                        if (SolutionFound(S, Field)){
+                            S->BackupTo = -1; // Don't look for more solutions, just back out
+                        }
+                        STATS_LEAVE();
                         return;
                     }
                 }
@@ -944,36 +1919,102 @@ void SolvePuzzle(int px,int py,int pz)
         unsigned long FitWord;
         int NumFits;
         int TryLevel;
-        TryLevel = NumPlaced;
+        TryLevel = S->NumPlaced;
 back_up_one:
-        Field = &Stages[TryLevel];
-        FitWord = ComputeFitWord(Field, px, py, pz);
+        if (UseUndoLog){
+            RewindTo(S, Field, TryLevel);
+        }else{
+            Field = &S->Stages[TryLevel];
+        }
         NumFits = 0;
         // Now find a piece to fit.
         {
-            int PieceNum, or;
-            for (PieceNum=0;PieceNum<NUM_PIECES;PieceNum++){
+            int PieceNum, or, k, NumTries;
+            int Pos = px*T->XStride+py*T->YStride+pz;
+            const int * Start = CELL_START(T,Pos);
+            const CellPlace_t * Place = NULL;
+            Field_t * Dest;
+            u64 Around = 0;
+            uint32_t Candidates = 0;
+
+            if (FitMethod == FIT_WIDE){
+                Around = ComputeAround(T, Field, Pos);
+                FitWord = 0;
+            }else{
+                FitWord = ComputeFitWord(T, Field, px, py, pz);
+            }
+            for (PieceNum=0;PieceNum<T->NumPieces;PieceNum++){
                 if (Field->IsUsed[PieceNum]) continue; // Piece already used up.
-                for (or=0;or<AllPieces[PieceNum].NumOrientations;or++){
-                    if (FitWord & AllPieces[PieceNum].FitOpt[or].FitWord) continue;
-                    if (CheckPlacement(Field, px,py,pz, PieceNum, or)){
+                // Resuming, skip to the piece that was placed here.
+                if (S->NumPlaced < S->ResumeDepth && PieceNum != S->Placed[S->NumPlaced].PieceNum) continue;
+                if (FitMethod >= FIT_LISTS){
+                    // Only the orientations that stay in the field.
+                    Place = T->CellPlaces + Start[PieceNum];
+                    NumTries = Start[PieceNum+1] - Start[PieceNum];
+                    if (FitMethod == FIT_WIDE){
+                        Candidates = FitBatch(T->CellMasks + Start[PieceNum], NumTries, Around);
+                    }
+                }else{
+                    NumTries = T->AllPieces[PieceNum].NumOrientations;
+                }
+                S->FitTests += NumTries;
+                for (k=0;k<NumTries;k++){
+                    int Fits;
+                    STATS_COUNT(Tries);
+                    if (FitMethod == FIT_WIDE){
+                        // Straight to the next one that fits.
+                        if (!Candidates) break;
+                        k = LowestBit(Candidates);
+                        Candidates &= Candidates-1;
+                        or = Place[k].Orientation;
+                        S->FitPasses += 1;
+                        Fits = TRUE;
+                    }else if (FitMethod == FIT_LISTS){
+                        or = Place[k].Orientation;
+                        if (FitWord & Place[k].FitWord) continue;
+                        S->FitPasses += 1;
+                        Fits = CheckPlacementCubes(Field, Pos, &Place[k]);
+                    }else{
+                        or = k;
+                        if (FitWord & T->AllPieces[PieceNum].FitOpt[or].FitWord) continue;
+                        S->FitPasses += 1;
+                        Fits = FitMethod == FIT_BITS
+                            ? CheckPlacementBits(Field, Pos, T->AllPieces[PieceNum].FitOpt[or].Mask)
+                            : CheckPlacement(T, Field, px,py,pz, PieceNum, or);
+                    }
+                    if (S->NumPlaced < S->ResumeDepth && or != S->Placed[S->NumPlaced].Orientation) continue;
+                    if (Fits){
                         NumFits += 1;
-                        if (TryLevel != NumPlaced){
+                        if (TryLevel != S->NumPlaced){
                             // We are testing if backing up by a move makes filling a certain
                             // cube possible.
                             // As we now know is that it is possible, no need to go further.
+                            STATS_COUNT(Redundant);
                             goto backout_shortcut;
                         }
-                        Stages[NumPlaced+1] = Stages[NumPlaced];
-                        PlacePiece(&Stages[NumPlaced+1], px,py,pz, PieceNum, or);
-                        if (NumPlaced > 31) printf("\nNumPlaced borked 2\n");
+                        STATS_FIT();
+                        if (UseUndoLog){
+                            Dest = Field;
+                        }else{
+                            CopyField(S, &S->Stages[S->NumPlaced+1], &S->Stages[S->NumPlaced]);
+                            Dest = &S->Stages[S->NumPlaced+1];
+                        }
+                        if (FitMethod >= FIT_LISTS){
+                            PlacePieceCubes(S, Dest, Pos, PieceNum, &Place[k]);
+                        }else if (FitMethod == FIT_BITS){
+                            PlacePieceBits(S, Dest, Pos, PieceNum, or);
+                        }else{
+                            PlacePiece(S, Dest, px,py,pz, PieceNum, or);
+                        }
+                        if (UseUndoLog) LogPlacement(S, Pos, PieceNum, or);
+                        if (S->NumPlaced >= T->NumPieces) printf("\nNumPlaced borked 2\n");
                     
-                        Placed[NumPlaced].PieceNum = PieceNum;
-                        Placed[NumPlaced].Orientation = or;
-                        Placed[NumPlaced].x = px;
-                        Placed[NumPlaced].y = py;
-                        Placed[NumPlaced].z = pz;
-                        NumPlaced += 1;
+                        S->Placed[S->NumPlaced].PieceNum = PieceNum;
+                        S->Placed[S->NumPlaced].Orientation = or;
+                        S->Placed[S->NumPlaced].x = px;
+                        S->Placed[S->NumPlaced].y = py;
+                        S->Placed[S->NumPlaced].z = pz;
+                        S->NumPlaced += 1;
                         NumFits += 1;
 
                         #ifndef TEST_MODULE
@@ -982,26 +2023,28 @@ back_up_one:
                             static int div;
                             if (div++ > 200000){
                                 printf("x=%d\n",px);
-                                ShowMap(Field, -1);
+                                ShowMap(T, Field, -1);
                                 div = 0;
                             }
                         }
                         #endif
 
-                        SolvePuzzle(px,py,pz);
+                        SolvePuzzle(S, px,py,pz);
                         // Returns if nothing worked or we finished this solution.
                         // Now un-place the piece for the next try.
 
-                        NumPlaced -= 1;
+                        S->NumPlaced -= 1;
+                        if (UseUndoLog) RewindTo(S, Field, S->NumPlaced);
 
-                        if (BackupTo < NumPlaced){
+                        if (S->BackupTo < S->NumPlaced){
                             // In attempting to fill a cube in some level of recursion down
                             // from here, we found that it could only be filled by unplacing a number
                             // of pieces, so we just pop the levels of recursion.
-                            // printf("abort at level %d\n",NumPlaced);
+                            // printf("abort at level %d\n",S->NumPlaced);
+                            STATS_LEAVE();
                             return;
                         }else{
-                            BackupTo = 1000;
+                            S->BackupTo = 1000;
                         }
                     }
                 }
@@ -1009,7 +2052,7 @@ back_up_one:
         }
 backout_shortcut:
         if (NumFits == 0){
-            if (px < FIELD_X_SIZE-1){
+            if (px < T->FieldX-1 && !CountAll){
                 // If no piece can be used to fill the poosition at px,py,pz, then back up
                 // in the placed pieces until that square can be filled.  Rather than building
                 // up again at every level, we first check how far we need to back up until 
@@ -1027,30 +2070,31 @@ backout_shortcut:
                 goto back_up_one;
             }
         }else{
-            if (TryLevel != NumPlaced){
+            if (TryLevel != S->NumPlaced){
                 // If we find that a lot of stuff needs to get unplaced in order to fill the
                 // target cube, then there's no point in exploring all the remaining possibilites
                 // of filling the squares betwen the level we had to back up to and the present
-                // target cube.  Setting of "BackupTo" causes levels of recursion to subsequently
+                // target cube.  Setting of "S->BackupTo" causes levels of recursion to subsequently
                 // just pop off.
                 
-                //printf("Should back up from %2d to %2d\n",NumPlaced, TryLevel);
-                BackupTo = TryLevel;
+                //printf("Should back up from %2d to %2d\n",S->NumPlaced, TryLevel);
+                S->BackupTo = TryLevel;
                 // And return.
             }
         }
     }
+    STATS_LEAVE();
 }
 
 //-------------------------------------------------------------------------------
 // Show picutres of the pieces
 //-------------------------------------------------------------------------------
-void ShowPieces(void)
+void ShowPieces(const PuzzleTables_t * T)
 {
     int a;
-    for (a=0;a<NUM_PIECES;a++){
+    for (a=0;a<T->NumPieces;a++){
         Map_t Map;
-        Map = AllPieces[a].Orientations[0];
+        Map = T->AllPieces[a].Orientations[0];
         printf("Piece %d:\n",a+1);
         Show5_FrontAndBack(&Map);
         printf("\n");
@@ -1058,79 +2102,1044 @@ void ShowPieces(void)
 }
 
 //-------------------------------------------------------------------------------
-// Create an empty solution field with no pieces in it yet.
+// Make a solver for the puzzle the tables are for, with the fields for each
+// level of the search and the list of placed pieces.  It finds the first
+// solution with the byte map fit test, unless told otherwise.
+//-------------------------------------------------------------------------------
+Solver_t * NewSolver(const PuzzleTables_t * T)
+{
+    Solver_t * S;
+    int a;
+
+    S = (Solver_t *)MustRealloc(NULL, sizeof(Solver_t), "solver");
+    memset(S, 0, sizeof(Solver_t));
+    S->T = T;
+    S->FitMethod = FIT_MAP;
+    S->CheckpointEvery = 60;
+    S->Stages = (Field_t *)MustRealloc(NULL, (T->NumPieces+1)*sizeof(Field_t), "stages");
+    S->StagesBlock = (char *)MustRealloc(NULL, (size_t)(T->NumPieces+1)*T->FieldBytes, "stages");
+    for (a=0;a<=T->NumPieces;a++){
+        SetFieldBlock(T, &S->Stages[a], S->StagesBlock + (size_t)a*T->FieldBytes);
+    }
+    S->Placed = (PlacedPos_t *)MustRealloc(NULL, (T->NumPieces+1)*sizeof(PlacedPos_t), "stages");
+    S->UndoCubes = (int *)MustRealloc(NULL, 5*T->NumPieces*sizeof(int), "undo log");
+    S->UndoLevels = (UndoLevel_t *)MustRealloc(NULL, (T->NumPieces+1)*sizeof(UndoLevel_t), "undo log");
+    return S;
+}
+
+//-------------------------------------------------------------------------------
+// For threads that are done solving.  The tables are left alone, as other
+// solvers may still be using them.
 //-------------------------------------------------------------------------------
-void InitEmtpyField(void)
+void FreeSolver(Solver_t * S)
 {
+    if (!S) return;
+    free(S->Stages);
+    free(S->StagesBlock);
+    free(S->Placed);
+    free(S->UndoCubes);
+    free(S->UndoLevels);
+    free(S);
+}
+
+//-------------------------------------------------------------------------------
+// Create an empty solution field with no pieces in it yet, and reset the
+// counts, ready to search.
+//-------------------------------------------------------------------------------
+void InitEmtpyField(Solver_t * S)
+{
+    const PuzzleTables_t * T = S->T;
     Field_t Field;
+    Field = S->Stages[0];
+
     // Initialize the empty field.
     {
         int x,y,z;
-        memset(&Field, 0, sizeof(Field_t));
-        for (y=0;y<FIELD_Y_SIZE+1;y++){
-            for (z=0;z<FIELD_Z_SIZE+1;z++){
-                Field.Map[FIELD_X_SIZE][y][z] = -1; // End boundary.
+        memset(Field.Bits, 0, T->FieldBytes);
+        for (y=0;y<T->FieldY+1;y++){
+            for (z=0;z<T->FieldZ+1;z++){
+                Field.Map[T->FieldX*T->XStride+y*T->YStride+z] = -1; // End boundary.
             }
         }
-        for (x=0;x<FIELD_X_SIZE;x++){
-            for (y=0;y<FIELD_Y_SIZE+1;y++){
-                Field.Map[x][y][FIELD_Z_SIZE] = -1; // Top boundary
+        for (x=0;x<T->FieldX;x++){
+            for (y=0;y<T->FieldY+1;y++){
+                Field.Map[x*T->XStride+y*T->YStride+T->FieldZ] = -1; // Top boundary
             }
-            for (z=0;z<FIELD_Z_SIZE+1;z++){
-                Field.Map[x][FIELD_Y_SIZE][z] = -1; // Side boundary.
+            for (z=0;z<T->FieldZ+1;z++){
+                Field.Map[x*T->XStride+T->FieldY*T->YStride+z] = -1; // Side boundary.
             }
         }
+        // And the extra guards before and after.
+        memset(Field.Map-T->MapFront, -1, T->MapFront);
+        memset(Field.Map+T->MapCubes, -1, T->MapBytes-T->MapCubes);
+    }
+
+    // Bitboard has the boundaries, and everything past the map, filled.
+    {
+        int c;
+        for (c=0;c<BITS_WORDS*64;c++){
+            if (c >= T->MapCubes || Field.Map[c]) Field.Bits[c >> 6] |= 1ULL << (c & 63);
+        }
     }
 
     //ShowMap(&Field);
-    PlacementsTried = 0;
-    NumPlaced = 0;
-    BackupTo = 1000;
-    Stages[0] = Field;
+    S->PlacementsTried = 0;
+    S->NumPlaced = 0;
+    S->BackupTo = 1000;
+    S->UndoTop = 0;
+    S->Applied = 0;
+    S->StateBytes = 0;
+    S->SearchNodes = 0;
+    S->FitTests = 0;
+    S->FitPasses = 0;
+    S->CountSolutions = 0;
+    S->ResumeDepth = 0;
+    S->NextCheckpoint = GetTimeSec() + S->CheckpointEvery;
 }
 
+//-------------------------------------------------------------------------------
+// Read a piece, as up to 5 cubes like "0,0,0 1,0,0 1,1,0".  They must all
+// be within 0-4, and joined up.  Returns FALSE if it's no good.
+//-------------------------------------------------------------------------------
+static int ParsePiece(const char * Line, PieceList_t * Piece)
+{
+    int Cubes[5][3];
+    int Joined[5] = {TRUE};
+    int n = 0, a, b, Pass, Len;
+
+    for (;;){
+        int x,y,z;
+        if (sscanf(Line, " %d,%d,%d%n", &x,&y,&z,&Len) != 3) break;
+        if (n >= 5 || x < 0 || x > 4 || y < 0 || y > 4 || z < 0 || z > 4) return FALSE;
+        Cubes[n][0] = x;
+        Cubes[n][1] = y;
+        Cubes[n][2] = z;
+        n++;
+        Line += Len;
+    }
+    if (n == 0 || Line[strspn(Line, " \t\r\n")]) return FALSE;
+
+    // Every cube must be joined to the first one through the others.
+    for (Pass=0;Pass<n;Pass++){
+        for (a=1;a<n;a++){
+            for (b=0;b<n;b++){
+                int Dist = abs(Cubes[a][0]-Cubes[b][0]) + abs(Cubes[a][1]-Cubes[b][1])
+                         + abs(Cubes[a][2]-Cubes[b][2]);
+                if (Dist == 0 && a != b) return FALSE; // Same cube twice
+                if (Dist == 1 && Joined[b]) Joined[a] = TRUE;
+            }
+        }
+    }
+    for (a=0;a<n;a++) if (!Joined[a]) return FALSE;
+
+    // Unused entries repeat the first cube.
+    memset(Piece, 0, sizeof(PieceList_t));
+    for (a=0;a<5;a++){
+        b = a < n ? a : 0;
+        Piece->cubes[a].x = (char)Cubes[b][0];
+        Piece->cubes[a].y = (char)Cubes[b][1];
+        Piece->cubes[a].z = (char)Cubes[b][2];
+    }
+    return TRUE;
+}
+
+//-------------------------------------------------------------------------------
+// Set the size of the box, and optionally the pieces, from either a size
+// like "6x5x5" or a file with lines like:
+//    # Comment
+//    size 6 5 5
+//    piece 0,0,0 1,0,0 2,0,0 3,0,0 4,0,0
+//    piece 0,0,0 1,0,0 2,0,0
+// If the file has any pieces, they replace the whole set.  Returns FALSE
+// if there's something wrong with it.
+//-------------------------------------------------------------------------------
+int Pento3dSetPuzzle(const char * Spec)
+{
+    static PieceList_t * Loaded;
+    PieceList_t * NewPieces = NULL;
+    int x = FieldX, y = FieldY, z = FieldZ;
+    int NumNew = 0, Cubes = 0, a;
+    char Line[200], Extra;
+
+    if (sscanf(Spec, "%dx%dx%d%c", &x,&y,&z,&Extra) != 3){
+        FILE * f = fopen(Spec, "r");
+        int LineNum = 0;
+        if (!f){
+            printf("Can't open 3D puzzle file %s\n", Spec);
+            return FALSE;
+        }
+        while (fgets(Line, sizeof(Line), f)){
+            char * p = Line + strspn(Line, " \t");
+            int Ok;
+            LineNum++;
+            if (*p == '#' || *p == '\r' || *p == '\n' || *p == '\0') continue;
+            if (!strncmp(p, "size", 4)){
+                Ok = sscanf(p+4, "%d %d %d", &x,&y,&z) == 3;
+            }else if (!strncmp(p, "piece", 5) && NumNew < MAX_PIECES){
+                NewPieces = (PieceList_t *)MustRealloc(NewPieces, (NumNew+1)*sizeof(PieceList_t), "pieces");
+                Ok = ParsePiece(p+5, &NewPieces[NumNew++]);
+            }else{
+                Ok = FALSE;
+            }
+            if (!Ok){
+                printf("%s line %d: '%s' not understood\n", Spec, LineNum, strtok(p, "\r\n"));
+                fclose(f);
+                free(NewPieces);
+                return FALSE;
+            }
+        }
+        fclose(f);
+    }
+
+    if (x < 1 || x > MAX_FIELD_SIZE || y < 1 || y > MAX_FIELD_SIZE || z < 1 || z > MAX_FIELD_SIZE){
+        printf("3D puzzle sizes must be 1 to %d\n", MAX_FIELD_SIZE);
+        free(NewPieces);
+        return FALSE;
+    }
+    FieldX = x;
+    FieldY = y;
+    FieldZ = z;
+    if (NumNew){
+        free(Loaded);
+        Loaded = Pieces = NewPieces;
+        NumPieces = NumNew;
+    }
+
+    for (a=0;a<NumPieces;a++){
+        Map_t Map;
+        int c;
+        ReadPiece(&Map, &Pieces[a]);
+        for (c=0;c<5*5*5;c++) Cubes += ((char *)Map.Data)[c] != 0;
+    }
+    printf("3D puzzle %dx%dx%d (%d cubes), %d pieces of %d cubes\n",
+            FieldX, FieldY, FieldZ, FieldX*FieldY*FieldZ, NumPieces, Cubes);
+    return TRUE;
+}
 
 #ifdef TEST_MODULE
+// The tables for the puzzle the tests are on, made when first needed, and
+// again if Pento3dSetPuzzle changed it.  One per thread the
+// tests run on, as each runs the tests on its own.
+static thread_local PuzzleTables_t * Tables;
+
+static const PuzzleTables_t * TestTables(void)
+{
+    if (Tables && (Tables->FieldX != FieldX || Tables->FieldY != FieldY || Tables->FieldZ != FieldZ
+            || Tables->Pieces != Pieces || Tables->NumPieces != NumPieces)){
+        FreeTables(Tables);
+        Tables = NULL;
+    }
+    if (!Tables) Tables = MakeTables(0, FALSE);
+    return Tables;
+}
+
 //-------------------------------------------------------------------------------
 // Just find a solution for benchmarking
 //-------------------------------------------------------------------------------
 int Time3dPentominoSolver(void)
 {
-    PreparePieces();
-    InitEmtpyField();
-    SolvePuzzle(0,0,0);
-    return PlacementsTried;
-}    
+    Solver_t * S = NewSolver(TestTables());
+    int Tried;
+
+    InitEmtpyField(S);
+    STATS_RESET();
+    SolvePuzzle(S, 0,0,0);
+    STATS_PRINT("3D");
+    Tried = (int)S->PlacementsTried;
+    FreeSolver(S);
+    return Tried;
+}
+
+//-------------------------------------------------------------------------------
+// Run the solver to the first solution with one of the fit tests.  Returns
+// the time, and the number of placements and the solution.
+//-------------------------------------------------------------------------------
+static double TimeFitMethod(Solver_t * S, int Method, int * Tried, PlacedPos_t * Solution)
+{
+    int NumPieces = S->T->NumPieces;
+    double start;
+
+    S->FitMethod = Method;
+    InitEmtpyField(S);
+    memset(S->Placed, 0, NumPieces*sizeof(PlacedPos_t));
+    start = GetTimeSec();
+    SolvePuzzle(S, 0,0,0);
+    start = GetTimeSec()-start;
+
+    *Tried = (int)S->PlacementsTried;
+    memcpy(Solution, S->Placed, NumPieces*sizeof(PlacedPos_t));
+    return start;
+}
+
+//-------------------------------------------------------------------------------
+// Time the solver with the bitboard fit test against the byte map one.
+// Returns how many times faster the bitboard is, or -1 if it doesn't find
+// the same first solution.
+//-------------------------------------------------------------------------------
+double Pentomino3dBitsTest(void)
+{
+    const PuzzleTables_t * T = TestTables();
+    PlacedPos_t * Solutions[2];
+    Solver_t * S;
+    double Times[2];
+    int Tried[2], Same;
+
+    if (!T->BitsUsable){
+        printf("3D field too big for the bitboard\n");
+        return -1;
+    }
+    S = NewSolver(T);
+    Solutions[0] = (PlacedPos_t *)MustRealloc(NULL, 2*T->NumPieces*sizeof(PlacedPos_t), "solutions");
+    Solutions[1] = Solutions[0] + T->NumPieces;
+    Times[0] = TimeFitMethod(S, FIT_MAP, &Tried[0], Solutions[0]);
+    Times[1] = TimeFitMethod(S, FIT_BITS, &Tried[1], Solutions[1]);
+    FreeSolver(S);
+
+#ifdef __AVX2__
+    printf("3D bitboard fit test, AVX2\n");
+#else
+    printf("3D bitboard fit test, 64 bit words (make AVX2=1 for AVX2)\n");
+#endif
+    printf("  byte map: %9d placements  %7.3f s\n", Tried[0], Times[0]);
+    printf("  bitboard: %9d placements  %7.3f s\n", Tried[1], Times[1]);
+
+    Same = !memcmp(Solutions[0], Solutions[1], T->NumPieces*sizeof(PlacedPos_t));
+    free(Solutions[0]);
+    if (!Same || Tried[0] != Tried[1]){
+        printf("Bitboard found a different solution\n");
+        return -1;
+    }
+    return Times[0] / Times[1];
+}
+
+//-------------------------------------------------------------------------------
+// Time the solver going through the per cube placement lists against the
+// original.  Returns how many times faster the lists are, or -1 if they
+// don't find the same first solution.
+//-------------------------------------------------------------------------------
+double Pentomino3dListsTest(void)
+{
+    const PuzzleTables_t * T = TestTables();
+    Solver_t * S = NewSolver(T);
+    PlacedPos_t * Solutions[2];
+    double Times[2];
+    int Tried[2], a, Orientations = 0, Longest = 0, Same;
+
+    Solutions[0] = (PlacedPos_t *)MustRealloc(NULL, 2*T->NumPieces*sizeof(PlacedPos_t), "solutions");
+    Solutions[1] = Solutions[0] + T->NumPieces;
+    Times[0] = TimeFitMethod(S, FIT_MAP, &Tried[0], Solutions[0]);
+    Times[1] = TimeFitMethod(S, FIT_LISTS, &Tried[1], Solutions[1]);
+    FreeSolver(S);
+
+    for (a=0;a<T->NumPieces;a++) Orientations += T->AllPieces[a].NumOrientations;
+    for (a=0;a<T->MapCubes;a++){
+        int Len = CELL_START(T,a)[T->NumPieces] - CELL_START(T,a)[0];
+        if (Len > Longest) Longest = Len;
+    }
+    printf("3D placement lists: %d orientations, %d placements in the lists\n",
+            Orientations, T->NumCellPlaces);
+    printf("  orientation maps %d bytes, longest list %d bytes\n",
+            (int)(Orientations*sizeof(Map_t)), (int)(Longest*sizeof(CellPlace_t)));
+    printf("  maps:  %9d placements  %7.3f s\n", Tried[0], Times[0]);
+    printf("  lists: %9d placements  %7.3f s\n", Tried[1], Times[1]);
+
+    Same = !memcmp(Solutions[0], Solutions[1], T->NumPieces*sizeof(PlacedPos_t));
+    free(Solutions[0]);
+    if (!Same || Tried[0] != Tried[1]){
+        printf("Placement lists found a different solution\n");
+        return -1;
+    }
+    return Times[0] / Times[1];
+}
+
+//-------------------------------------------------------------------------------
+// Time the search with the 64 cube fit mask, testing all the orientations
+// of a piece at once, against the 32 bit fit word and checking the cubes
+// of what gets past it.  Both go through the placement lists.  Returns how
+// many times faster the wide mask is, or -1 if it doesn't find the same
+// first solution.
+//-------------------------------------------------------------------------------
+double Pentomino3dWideTest(void)
+{
+    static const char * Names[2] = {"32 bit word:", "64 bit mask:"};
+    static const int Methods[2] = {FIT_LISTS, FIT_WIDE};
+    const PuzzleTables_t * T = TestTables();
+    Solver_t * S = NewSolver(T);
+    PlacedPos_t * Solutions[2];
+    double Times[2], Passed[2];
+    int Tried[2], a, Same;
+
+    Solutions[0] = (PlacedPos_t *)MustRealloc(NULL, 2*T->NumPieces*sizeof(PlacedPos_t), "solutions");
+    Solutions[1] = Solutions[0] + T->NumPieces;
+
+#ifdef __AVX2__
+    printf("3D wide fit mask, AVX2\n");
+#else
+    printf("3D wide fit mask, 64 bit words (make AVX2=1 for AVX2)\n");
+#endif
+    printf("                  tested     passed  pass %%     placed  time (s)\n");
+    for (a=0;a<2;a++){
+        Times[a] = TimeFitMethod(S, Methods[a], &Tried[a], Solutions[a]);
+        Passed[a] = (double)S->FitPasses;
+        printf("  %s %10.0f %10.0f  %5.1f%% %10d  %8.3f\n", Names[a],
+                (double)S->FitTests, Passed[a], S->FitTests ? Passed[a] * 100 / S->FitTests : 0,
+                Tried[a], Times[a]);
+    }
+    FreeSolver(S);
+    // Everything past the wide mask fits, as it covers the whole piece.
+    printf("  %.0f got past the 32 bit word but didn't fit\n", Passed[0]-Passed[1]);
+
+    Same = !memcmp(Solutions[0], Solutions[1], T->NumPieces*sizeof(PlacedPos_t));
+    free(Solutions[0]);
+    if (!Same || Tried[0] != Tried[1]){
+        printf("Wide fit mask found a different solution\n");
+        return -1;
+    }
+    return Times[0] / Times[1];
+}
+
+//-------------------------------------------------------------------------------
+// Time the search with the undo log against copying the field for each
+// level, both going through the placement lists.  Returns how many times
+// faster the undo log is, or -1 if it doesn't find the same first solution.
+//-------------------------------------------------------------------------------
+double Pentomino3dUndoTest(void)
+{
+    static const char * Names[2] = {"copies:  ", "undo log:"};
+    const PuzzleTables_t * T = TestTables();
+    Solver_t * S = NewSolver(T);
+    PlacedPos_t * Solutions[2];
+    double Times[2];
+    int Tried[2], a, Same;
+
+    Solutions[0] = (PlacedPos_t *)MustRealloc(NULL, 2*T->NumPieces*sizeof(PlacedPos_t), "solutions");
+    Solutions[1] = Solutions[0] + T->NumPieces;
+
+    printf("3D search state, %d byte fields\n", T->FieldBytes);
+    for (a=0;a<2;a++){
+        S->UseUndoLog = a;
+        Times[a] = TimeFitMethod(S, FIT_LISTS, &Tried[a], Solutions[a]);
+        printf("  %s %9d placements  %7.3f s  %6.1f bytes/node\n", Names[a],
+                Tried[a], Times[a], S->SearchNodes ? S->StateBytes / S->SearchNodes : 0);
+    }
+    FreeSolver(S);
+
+    Same = !memcmp(Solutions[0], Solutions[1], T->NumPieces*sizeof(PlacedPos_t));
+    free(Solutions[0]);
+    if (!Same || Tried[0] != Tried[1]){
+        printf("Undo log found a different solution\n");
+        return -1;
+    }
+    return Times[0] / Times[1];
+}
+
+//-------------------------------------------------------------------------------
+// Counting all the solutions in parallel.  The tree is cut into tasks after
+// the first few pieces, and each task stops after a fixed number of
+// placements, so the counts come out the same however the tasks are spread
+// over the threads, and it doesn't take forever.  All the threads share
+// one set of tables, each with a solver of its own.
+//-------------------------------------------------------------------------------
+#define COUNT_SPLIT_DEPTH 1
+#define COUNT_TASK_PLACES 50000
+
+// One count, with a solver for each thread, made when it runs its first
+// task.
+typedef struct {
+    const PuzzleTables_t * T;
+    TaskList_t List;
+    int MaxPlaces;
+    Solver_t * Solvers[POOL_MAX_WORKERS];
+    long long WorkerSolutions[POOL_MAX_WORKERS];
+    long long WorkerPlaces[POOL_MAX_WORKERS];
+}Count_t;
+
+static Solver_t * CountSolver(Count_t * C)
+{
+    Solver_t * S = NewSolver(C->T);
+    S->FitMethod = FIT_LISTS;
+    S->CountAll = TRUE;
+    S->CountMaxPlaces = C->MaxPlaces;
+    return S;
+}
+
+static void CountRun(void * Context, int t, int Worker)
+{
+    Count_t * C = (Count_t *)Context;
+    CountTask_t * Task = &C->List.Tasks[t];
+    Solver_t * S = C->Solvers[Worker];
+    int FieldBytes = C->T->FieldBytes;
+
+    if (!S) S = C->Solvers[Worker] = CountSolver(C);
+    memcpy(S->Stages[Task->NumPlaced].Bits, C->List.Fields + (size_t)t*FieldBytes, FieldBytes);
+    S->NumPlaced = Task->NumPlaced;
+    S->PlacementsTried = 0;
+    S->CountSolutions = 0;
+    S->BackupTo = 1000;
+    SolvePuzzle(S, Task->x, Task->y, Task->z);
+
+    Task->Solutions = S->CountSolutions;
+    Task->Places = S->PlacementsTried;
+    C->WorkerSolutions[Worker] += S->CountSolutions;
+    C->WorkerPlaces[Worker] += S->PlacementsTried;
+}
+
+//-------------------------------------------------------------------------------
+// Set up a count of the puzzle T is for, cut into tasks at Depth.
+//-------------------------------------------------------------------------------
+static Count_t * NewCount(const PuzzleTables_t * T, int Depth)
+{
+    Count_t * C;
+    Solver_t * S;
+
+    C = (Count_t *)MustRealloc(NULL, sizeof(Count_t), "count");
+    memset(C, 0, sizeof(Count_t));
+    C->T = T;
+    S = CountSolver(C);
+    InitEmtpyField(S);
+    S->SplitDepth = Depth;
+    S->Split = &C->List;
+    SolvePuzzle(S, 0,0,0);
+    FreeSolver(S);
+    return C;
+}
+
+static void FreeCount(Count_t * C)
+{
+    int a;
+    for (a=0;a<POOL_MAX_WORKERS;a++) FreeSolver(C->Solvers[a]);
+    free(C->List.Tasks);
+    free(C->List.Fields);
+    free(C);
+}
+
+//-------------------------------------------------------------------------------
+// Count on 1, 2, 4... threads, up to one per core.  Returns millions of
+// placements per second on all cores, or -1 if the counts don't agree.
+//-------------------------------------------------------------------------------
+double Pentomino3dCountTest(void)
+{
+    int Cores = PoolCores();
+    int Threads, a;
+    long long Solutions1 = 0, Places1 = 0;
+    double OneThread = 0, Rate = 0;
+    Count_t * C;
+
+    if (Cores > POOL_MAX_WORKERS) Cores = POOL_MAX_WORKERS;
+
+    C = NewCount(TestTables(), COUNT_SPLIT_DEPTH);
+
+    printf("Counting 3D solutions, %d tasks of up to %d placements, %d cores\n",
+            C->List.NumTasks, COUNT_TASK_PLACES, Cores);
+    printf("  threads   time (s)  solutions   placements  speedup\n");
+    C->MaxPlaces = COUNT_TASK_PLACES;
+    for (Threads=1;;Threads*=2){
+        double start;
+        long long Places = 0, TaskPlaces = 0, Solutions = 0, TaskSolutions = 0;
+
+        if (Threads > Cores) Threads = Cores;
+        memset(C->WorkerSolutions, 0, sizeof(C->WorkerSolutions));
+        memset(C->WorkerPlaces, 0, sizeof(C->WorkerPlaces));
+
+        start = GetTimeSec();
+        RunTaskPool(Threads, C->List.NumTasks, NULL, CountRun, NULL, C);
+        start = GetTimeSec()-start;
+        for (a=0;a<Threads;a++){
+            FreeSolver(C->Solvers[a]);
+            C->Solvers[a] = NULL;
+        }
+
+        // Merge the counts from the threads, and check them against the tasks.
+        for (a=0;a<Threads;a++){
+            Solutions += C->WorkerSolutions[a];
+            Places += C->WorkerPlaces[a];
+        }
+        for (a=0;a<C->List.NumTasks;a++){
+            TaskSolutions += C->List.Tasks[a].Solutions;
+            TaskPlaces += C->List.Tasks[a].Places;
+        }
+        if (Threads == 1){
+            Solutions1 = Solutions;
+            Places1 = Places;
+            OneThread = start;
+        }
+        if (Solutions != TaskSolutions || Places != TaskPlaces
+                || Solutions != Solutions1 || Places != Places1){
+            printf("3D counts don't agree on %d threads\n", Threads);
+            Rate = -1;
+            break;
+        }
+
+        Rate = Places / start / 1e6;
+        printf("  %5d   %9.3f  %9.0f  %11.0f  %7.2f\n", Threads, start, (double)Solutions,
+                (double)Places, OneThread / start);
+        if (Threads >= Cores) break;
+    }
+    FreeCount(C);
+    return Rate;
+}
+
+//-------------------------------------------------------------------------------
+// Count every solution of the twelve flat pentominos in a 10x6 box, lying
+// flat and standing on end, on all cores.  Both must come to the known
+// 9356, so this catches a count that misses part of the search.  With
+// symmetry breaking, so it takes less time.  Returns millions of placements
+// per second, or -1 if a count is wrong.
+//-------------------------------------------------------------------------------
+#define FULL_COUNT_SPLIT_DEPTH 2
+#define FULL_COUNT_SOLUTIONS 9356
+
+double Pentomino3dFullCountTest(void)
+{
+    static const int Boxes[2][3] = {{10,6,1}, {1,6,10}};
+    int Cores = PoolCores();
+    int a, b, Ok = TRUE;
+    double AllPlaces = 0, AllTime = 0;
+
+    if (Cores > POOL_MAX_WORKERS) Cores = POOL_MAX_WORKERS;
+
+    printf("Counting all 3D solutions of the flat pentominos, %d cores\n", Cores);
+    printf("  box      tasks   time (s)  solutions   placements\n");
+    for (b=0;b<2;b++){
+        PuzzleTables_t * T;
+        Count_t * C;
+        double start;
+        long long Solutions = 0, Places = 0;
+
+        T = MakePuzzleTables(Boxes[b][0], Boxes[b][1], Boxes[b][2], DefaultPieces, 12, 0, TRUE);
+        start = GetTimeSec();
+        C = NewCount(T, FULL_COUNT_SPLIT_DEPTH);
+        RunTaskPool(Cores, C->List.NumTasks, NULL, CountRun, NULL, C);
+        start = GetTimeSec()-start;
+
+        for (a=0;a<Cores;a++){
+            Solutions += C->WorkerSolutions[a];
+            Places += C->WorkerPlaces[a];
+        }
+        Solutions *= T->SymmetryOrder;
+        printf("  %2dx%dx%-2d  %5d  %9.3f  %9.0f  %11.0f\n", T->FieldX, T->FieldY, T->FieldZ,
+                C->List.NumTasks, start, (double)Solutions, (double)Places);
+        if (Solutions != FULL_COUNT_SOLUTIONS){
+            printf("%dx%dx%d should have %d solutions\n", T->FieldX, T->FieldY, T->FieldZ,
+                    FULL_COUNT_SOLUTIONS);
+            Ok = FALSE;
+        }
+        AllPlaces += Places;
+        AllTime += start;
+        FreeCount(C);
+        FreeTables(T);
+    }
+    return Ok ? AllPlaces / AllTime / 1e6 : -1;
+}
+
+//-------------------------------------------------------------------------------
+// Racing for the first solution on 1, 2, 4... threads.  Thread t runs the
+// search with variant t of the piece order, 0 being the usual one, so
+// more threads just add more orders to the race.  The order is in the
+// tables, so each one makes its own.
+//-------------------------------------------------------------------------------
+typedef struct {
+    RaceFlag_t Over;
+    double Start, Time;
+    int Winner, Places;
+}Race_t;
+
+//-------------------------------------------------------------------------------
+// Claim the race.  Only the first thread to call it gets TRUE.
+//-------------------------------------------------------------------------------
+static int ClaimRace(RaceFlag_t * Over)
+{
+#ifdef _MSC_VER
+    return InterlockedCompareExchange(Over, 1, 0) == 0;
+#else
+    return __sync_bool_compare_and_swap(Over, 0, 1);
+#endif
+}
+
+static void RaceRun(void * Context, int t, int Worker)
+{
+    Race_t * Race = (Race_t *)Context;
+    PuzzleTables_t * T = MakeTables(t, FALSE);
+    Solver_t * S = NewSolver(T);
+
+    (void)Worker;
+    S->FitMethod = FIT_WIDE;
+    S->RaceOver = &Race->Over;
+    InitEmtpyField(S);
+    SolvePuzzle(S, 0,0,0);
+
+    // If someone else won, this one stopped early without a solution.
+    if (S->CountSolutions && ClaimRace(&Race->Over)){
+        Race->Time = GetTimeSec()-Race->Start;
+        Race->Winner = t;
+        Race->Places = (int)S->PlacementsTried;
+    }
+    FreeSolver(S);
+    FreeTables(T);
+}
+
+//-------------------------------------------------------------------------------
+// Returns how many times sooner all cores find a solution than one does.
+//-------------------------------------------------------------------------------
+double Pentomino3dRaceTest(void)
+{
+    int Cores = PoolCores();
+    int Threads;
+    double OneThread = 0, Speedup = 0;
+    Race_t Race;
+
+    if (Cores > POOL_MAX_WORKERS) Cores = POOL_MAX_WORKERS;
+
+    printf("Racing 3D searches in different piece orders, %d cores\n", Cores);
+    printf("  threads  first (s)  winner  placements  speedup\n");
+    for (Threads=1;;Threads*=2){
+        if (Threads > Cores) Threads = Cores;
+
+        memset(&Race, 0, sizeof(Race));
+        Race.Start = GetTimeSec();
+        RunTaskPool(Threads, Threads, NULL, RaceRun, NULL, &Race);
+        if (!Race.Over){
+            printf("No search in the race found a solution\n");
+            return -1;
+        }
+
+        if (Threads == 1) OneThread = Race.Time;
+        Speedup = OneThread / Race.Time;
+        printf("  %5d   %9.3f  %6d  %10d  %7.2f\n", Threads, Race.Time, Race.Winner, Race.Places, Speedup);
+        if (Threads >= Cores) break;
+    }
+    return Speedup;
+}
+
+//-------------------------------------------------------------------------------
+// Tables for a puzzle small enough to count all the solutions of, the twelve
+// flat pentominos in a 12x5x1 box.
+//-------------------------------------------------------------------------------
+static PuzzleTables_t * SmallTables(int Symmetry)
+{
+    return MakePuzzleTables(12, 5, 1, DefaultPieces, 12, 0, Symmetry);
+}
+
+//-------------------------------------------------------------------------------
+// Count straight through, and again stopping two thirds of the way and
+// resuming from the checkpoint, with checkpoints written often along the way.
+// On the small puzzle, so there are solutions on both sides of the stop.  Returns the
+// percentage of the time spent writing checkpoints, or -1 if the resumed
+// count doesn't come out the same.
+//-------------------------------------------------------------------------------
+#define CHECKPOINT_TEST_PLACES 3000000
+
+// Runs of the test so far, so each one writes a file of its own, as the
+// tests may be running on more than one thread at once.
+#ifdef _MSC_VER
+    static volatile long CheckpointRuns;
+#else
+    static volatile int CheckpointRuns;
+#endif
+
+double Pentomino3dCheckpointTest(void)
+{
+    PuzzleTables_t * T;
+    Solver_t * S;
+    double start, Times[3];
+    long long Solutions[3], Places[3];
+    int a, Bytes = 0;
+    char FileName[30];
+    FILE * f;
+
+#ifdef _MSC_VER
+    sprintf(FileName, "pento3d%d.ckp", (int)InterlockedIncrement(&CheckpointRuns));
 #else
+    sprintf(FileName, "pento3d%d.ckp", __sync_add_and_fetch(&CheckpointRuns, 1));
+#endif
+
+    T = SmallTables(FALSE);
+    S = NewSolver(T);
+    S->FitMethod = FIT_LISTS;
+    S->CountAll = TRUE;
+
+    // Straight through, then stopping part way, then resuming for the rest.
+    for (a=0;a<3;a++){
+        if (a >= 1){
+            S->CheckpointFile = FileName;
+            S->CheckpointEvery = 0.05;
+        }
+        InitEmtpyField(S);
+        S->CountMaxPlaces = a == 1 ? CHECKPOINT_TEST_PLACES/3*2 : CHECKPOINT_TEST_PLACES;
+        if (a == 2 && !ReadCheckpoint(S, FileName)) break;
+        start = GetTimeSec();
+        SolvePuzzle(S, 0,0,0);
+        Times[a] = GetTimeSec()-start;
+        Solutions[a] = S->CountSolutions;
+        Places[a] = S->PlacementsTried;
+        if (a == 1 && (f = fopen(FileName, "rb")) != NULL){
+            fseek(f, 0, SEEK_END);
+            Bytes = (int)ftell(f);
+            fclose(f);
+        }
+    }
+    remove(FileName);
+    FreeTables(T);
+    if (a < 3){
+        FreeSolver(S);
+        return -1;
+    }
+
+    printf("Checkpointing a 3D count, every %.2f s\n", 0.05);
+    printf("  straight:   %9.0f placements  %7.3f s  %.0f solutions\n", (double)Places[0], Times[0], (double)Solutions[0]);
+    printf("  stopped:    %9.0f placements  %7.3f s  %.0f solutions\n", (double)Places[1], Times[1], (double)Solutions[1]);
+    printf("  resumed:    %9.0f placements  %7.3f s  %.0f solutions\n", (double)Places[2], Times[2], (double)Solutions[2]);
+    printf("  %d checkpoints of %d bytes, %.3f ms each\n", S->Checkpoints, Bytes,
+            S->Checkpoints ? S->CheckpointSeconds * 1000 / S->Checkpoints : 0);
+    start = S->CheckpointSeconds * 100 / (Times[1] + Times[2]);
+    FreeSolver(S);
+
+    if (Solutions[2] != Solutions[0] || Places[2] != Places[0]){
+        printf("Resumed count doesn't match\n");
+        return -1;
+    }
+    return start;
+}
+
+//-------------------------------------------------------------------------------
+// Count all the solutions with and without symmetry breaking, on the small
+// puzzle.  Returns how many times fewer nodes it takes, or -1 if the
+// count doesn't go down by the number of symmetries.
+//-------------------------------------------------------------------------------
+double Pentomino3dSymmetryTest(void)
+{
+    PuzzleTables_t * T;
+    Solver_t * S;
+    long long Solutions[2], Nodes[2];
+    int Order = 1, Piece = -1, a;
+    double start, Times[2];
+
+    for (a=0;a<2;a++){
+        T = SmallTables(a);
+        Order = T->SymmetryOrder;
+        Piece = T->SymmetryPiece;
+        S = NewSolver(T);
+        S->FitMethod = FIT_LISTS;
+        S->CountAll = TRUE;
+        InitEmtpyField(S);
+        start = GetTimeSec();
+        SolvePuzzle(S, 0,0,0);
+        Times[a] = GetTimeSec()-start;
+        Solutions[a] = S->CountSolutions;
+        Nodes[a] = S->SearchNodes;
+        FreeSolver(S);
+        FreeTables(T);
+    }
+    printf("3D symmetry breaking, flat pentominos in 12x5x1, %d symmetries, piece %d restricted\n",
+            Order, Piece);
+    printf("  all:        %5.0f solutions %10.0f nodes  %7.3f s\n", (double)Solutions[0], (double)Nodes[0], Times[0]);
+    printf("  restricted: %5.0f solutions %10.0f nodes  %7.3f s\n", (double)Solutions[1], (double)Nodes[1], Times[1]);
+
+    // And what it finds for the puzzle the other tests use.
+    T = MakeTables(0, TRUE);
+    printf("  %dx%dx%d puzzle: %d symmetries, piece %d restricted\n",
+            T->FieldX, T->FieldY, T->FieldZ, T->SymmetryOrder, T->SymmetryPiece);
+    FreeTables(T);
+
+    if (Order < 2 || Solutions[0] != Solutions[1]*Order){
+        printf("Symmetry breaking count doesn't match\n");
+        return -1;
+    }
+    return (double)Nodes[0] / Nodes[1];
+}
+
+//-------------------------------------------------------------------------------
+// Time making the tables, making a solver, and the search on its own, then
+// race solvers through the same search on all cores, all reading the one
+// set of tables.  Returns the milliseconds of setup before a search can
+// start, or -1 if the solvers sharing the tables don't all get the same
+// result.
+//-------------------------------------------------------------------------------
+#define SETUP_REPEATS 10
+
+typedef struct {
+    const PuzzleTables_t * T;
+    int Places[2*POOL_MAX_WORKERS];
+}Shared_t;
+
+static void SharedRun(void * Context, int t, int Worker)
+{
+    Shared_t * Sh = (Shared_t *)Context;
+    Solver_t * S = NewSolver(Sh->T);
+
+    (void)Worker;
+    S->FitMethod = FIT_WIDE;
+    InitEmtpyField(S);
+    SolvePuzzle(S, 0,0,0);
+    Sh->Places[t] = (int)S->PlacementsTried;
+    FreeSolver(S);
+}
+
+double Pentomino3dSetupTest(void)
+{
+    PuzzleTables_t * T = NULL;
+    Solver_t * S = NULL;
+    double start, TableTime, SolverTime, SearchTime, Together;
+    double TableBytes, SolverBytes;
+    int Cores = PoolCores();
+    int a, NumTasks, Places, Same = TRUE;
+    Shared_t Shared;
+
+    if (Cores > POOL_MAX_WORKERS) Cores = POOL_MAX_WORKERS;
+
+    start = GetTimeSec();
+    for (a=0;a<SETUP_REPEATS;a++){
+        FreeTables(T);
+        T = MakeTables(0, FALSE);
+    }
+    TableTime = (GetTimeSec()-start) / SETUP_REPEATS;
+
+    start = GetTimeSec();
+    for (a=0;a<SETUP_REPEATS;a++){
+        FreeSolver(S);
+        S = NewSolver(T);
+        InitEmtpyField(S);
+    }
+    SolverTime = (GetTimeSec()-start) / SETUP_REPEATS;
+
+    S->FitMethod = FIT_WIDE;
+    start = GetTimeSec();
+    SolvePuzzle(S, 0,0,0);
+    SearchTime = GetTimeSec()-start;
+    Places = (int)S->PlacementsTried;
+    FreeSolver(S);
+
+    TableBytes = sizeof(PuzzleTables_t) + T->NumPieces*sizeof(PieceData_t)
+               + T->NumCellPlaces*(sizeof(CellPlace_t)+sizeof(u64))
+               + T->MapCubes*(T->NumPieces+1)*sizeof(int);
+    SolverBytes = sizeof(Solver_t) + (T->NumPieces+1)*(sizeof(Field_t)+T->FieldBytes
+               + sizeof(PlacedPos_t)+sizeof(UndoLevel_t)) + 5*T->NumPieces*sizeof(int);
+
+    // Two solvers per core, so some threads run more than one.
+    NumTasks = 2*Cores;
+    Shared.T = T;
+    start = GetTimeSec();
+    RunTaskPool(Cores, NumTasks, NULL, SharedRun, NULL, &Shared);
+    Together = GetTimeSec()-start;
+    for (a=0;a<NumTasks;a++) Same &= Shared.Places[a] == Places;
+
+    printf("3D solver setup, %dx%dx%d, %d pieces\n", T->FieldX, T->FieldY, T->FieldZ, T->NumPieces);
+    printf("  tables:  %8.3f ms  %8.1f KB, shared\n", TableTime*1000, TableBytes/1024);
+    printf("  solver:  %8.3f ms  %8.1f KB, each\n", SolverTime*1000, SolverBytes/1024);
+    printf("  search:  %8.3f ms  %8d placements\n", SearchTime*1000, Places);
+    printf("  %d solvers on %d threads, one set of tables: %.3f s\n", NumTasks, Cores, Together);
+    FreeTables(T);
+
+    if (!Same){
+        printf("Solvers sharing the tables didn't agree\n");
+        return -1;
+    }
+    return (TableTime + SolverTime) * 1000;
+}
+#else
+
+//-------------------------------------------------------------------------------
+// Wall clock seconds, as in timing.c, for building this on its own.
+//-------------------------------------------------------------------------------
+double GetTimeSec(void)
+{
+#if _WIN32 || _WIN64
+    LARGE_INTEGER freq_t, now_t;
+    QueryPerformanceFrequency(&freq_t);
+    QueryPerformanceCounter(&now_t);
+    return (double)now_t.QuadPart / freq_t.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
 
 //-------------------------------------------------------------------------------
 // Solve it and show a solution.
 //-------------------------------------------------------------------------------
 int main(int argc, char * argv[])
 {
-    int ShowPiecesFlag = 0;
+    PuzzleTables_t * T;
+    Solver_t * S;
+    int ShowPiecesFlag = 0, CountAll = FALSE, UseSymmetry = FALSE;
+    const char * ResumeFile = NULL;
+    const char * CheckpointFile = NULL;
+    double CountSeconds = 0, CheckpointEvery = 60;
     int a;
 
     for (a=1;a<argc;a++){
         if (!strcmp(argv[a], "pieces")){
             ShowPiecesFlag = TRUE;
+        }else if (!strcmp(argv[a], "puzzle") && a+1 < argc){
+            // Box size as XxYxZ, or a puzzle file.
+            if (!Pento3dSetPuzzle(argv[++a])) exit(-1);
+        }else if (!strcmp(argv[a], "count")){
+            // Count all solutions, optionally for a limited number of seconds.
+            CountAll = TRUE;
+            if (a+1 < argc && atoi(argv[a+1]) > 0){
+                CountSeconds = atoi(argv[++a]);
+            }
+        }else if (!strcmp(argv[a], "checkpoint") && a+1 < argc){
+            // Checkpoint file to write while counting, and how often.
+            CheckpointFile = argv[++a];
+            if (a+1 < argc && atof(argv[a+1]) > 0){
+                CheckpointEvery = atof(argv[++a]);
+            }
+        }else if (!strcmp(argv[a], "resume") && a+1 < argc){
+            ResumeFile = argv[++a];
+        }else if (!strcmp(argv[a], "symmetry")){
+            // Only find one of each set of rotated or mirrored solutions.
+            UseSymmetry = TRUE;
         }else{
             printf("Option %s not understood\n",argv[a]);
             exit(-1);
         }
     }
 
-    PreparePieces();
+    T = MakeTables(0, UseSymmetry);
 
     if (ShowPiecesFlag){
-        ShowPieces();
+        ShowPieces(T);
         exit(0);
     }
 
-    InitEmtpyField();
-    
-    SolvePuzzle(0,0,0);
+    S = NewSolver(T);
+    S->CountAll = CountAll;
+    S->CheckpointFile = CheckpointFile;
+    S->CheckpointEvery = CheckpointEvery;
+    InitEmtpyField(S);
+    if (CountSeconds) S->CountDeadline = GetTimeSec() + CountSeconds;
+
+    if (UseSymmetry){
+        if (T->SymmetryPiece >= 0){
+            printf("%d symmetries of the box, piece %d restricted\n", T->SymmetryOrder, T->SymmetryPiece);
+        }else{
+            printf("No symmetry breaking for this puzzle\n");
+        }
+    }
+    // Only the placement lists leave out the restricted placements.
+    if (CountAll || UseSymmetry) S->FitMethod = FIT_LISTS;
+    if (ResumeFile){
+        if (!CountAll){
+            printf("Can only resume counting\n");
+            exit(-1);
+        }
+        if (!ReadCheckpoint(S, ResumeFile)) exit(-1);
+    }
+    SolvePuzzle(S, 0,0,0);
+    if (CountAll){
+        printf("%.0f solutions, %.0f placements%s\n", (double)S->CountSolutions, (double)S->PlacementsTried,
+                S->BackupTo < 0 ? " (stopped at time limit)" : "");
+        if (T->SymmetryOrder > 1){
+            printf("%.0f with the symmetric ones\n", (double)S->CountSolutions*T->SymmetryOrder);
+        }
+        if (S->Checkpoints){
+            printf("%d checkpoints to %s, %.3f s\n", S->Checkpoints, CheckpointFile, S->CheckpointSeconds);
+        }
+    }
+    FreeSolver(S);
+    FreeTables(T);
     return 0;
 }
 #endif
-
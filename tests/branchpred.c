@@ -0,0 +1,340 @@
+//----------------------------------------------------------------------------
+// Branch predictor capacity tests.  Families of generated branch kernels that
+// vary the number of static branches, the period of a branch's pattern, how
+// far back in the history a branch's outcome was decided, and the number of
+// targets of an indirect branch.
+//
+// Each kernel is timed, and paired with the branch miss counter where the OS
+// lets us read it.  Where it doesn't, misses are estimated from the extra time
+// compared to running the same kernel on data that is always predicted right.
+//
+// This file must be compiled without if-conversion, or the compiler turns
+// the branches into conditional moves.
+//----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "perftest.h"
+
+#define BRANCHES_PER_RUN (1<<23)
+#define PATTERN_SIZE 65536
+#define MAX_STATIC 4096
+#define MAX_DEPTH 256
+#define MAX_TARGETS 64
+#define PREDICTED_MISS_RATE 0.1 // Below this, count the pattern as learned.
+
+typedef int (*BranchKernel_t)(const unsigned char * Data, int Param, int Iterations);
+
+static thread_local unsigned char Pattern[PATTERN_SIZE];
+static thread_local unsigned char Pattern2[PATTERN_SIZE];
+static const unsigned char Zeros[PATTERN_SIZE];
+static thread_local unsigned char Ones[MAX_DEPTH];
+static thread_local unsigned RandState;
+static thread_local double MissPenaltyNs;
+
+volatile int BranchSink;
+
+//----------------------------------------------------------------------------
+// Small repeatable random number generator (xorshift)
+//----------------------------------------------------------------------------
+static unsigned NextRand(void)
+{
+    RandState ^= RandState << 13;
+    RandState ^= RandState >> 17;
+    RandState ^= RandState << 5;
+    return RandState;
+}
+
+static void FillPattern(int Size, int Modulo)
+{
+    int a;
+    RandState = 2463534242u;
+    for (a=0;a<Size;a++){
+        Pattern[a] = (unsigned char)((NextRand() >> 8) % Modulo);
+    }
+    memcpy(Pattern2, Pattern, Size);
+}
+
+//----------------------------------------------------------------------------
+// One branch whose outcome repeats with a period of Param+1 (a power of two)
+//----------------------------------------------------------------------------
+static int PeriodKernel(const unsigned char * Data, int Mask, int Iterations)
+{
+    int i, t = 0;
+    for (i=0;i<Iterations;i++){
+        if (Data[i & Mask]){
+            t += 3;
+        }else{
+            t ^= 5;
+        }
+    }
+    return t;
+}
+
+//----------------------------------------------------------------------------
+// Many static branches, each with its own pattern of period 4.
+//----------------------------------------------------------------------------
+#define REP4(x) x x x x
+#define REP16(x) REP4(REP4(x))
+#define REP64(x) REP4(REP16(x))
+#define REP256(x) REP4(REP64(x))
+#define REP1024(x) REP4(REP256(x))
+#define REP4096(x) REP4(REP1024(x))
+
+#define STATIC_KERNEL(NUM)                                              \
+static int StaticKernel##NUM(const unsigned char * Data, int Param, int Iterations) \
+{                                                                       \
+    int j, t = 0;                                                       \
+    for (j=0;j<Iterations;j++){                                         \
+        const unsigned char * p = Data + (j & 3)*NUM;                   \
+        REP##NUM(if (*p++) t += 3; else t ^= 5;)                        \
+    }                                                                   \
+    return t;                                                           \
+}
+
+STATIC_KERNEL(4)
+STATIC_KERNEL(16)
+STATIC_KERNEL(64)
+STATIC_KERNEL(256)
+STATIC_KERNEL(1024)
+STATIC_KERNEL(4096)
+
+static const struct {
+    int NumBranches;
+    BranchKernel_t Kernel;
+}StaticKernels[] = {
+    {4, StaticKernel4}, {16, StaticKernel16}, {64, StaticKernel64},
+    {256, StaticKernel256}, {1024, StaticKernel1024}, {4096, StaticKernel4096}
+};
+
+//----------------------------------------------------------------------------
+// A random branch, then Depth always taken branches (and the loop branches),
+// then a branch with the same outcome as the first.  The last one can only
+// be predicted if the history reaches back to the first.
+// The second branch reads a copy of the data, so the compiler can't tell
+// it's the same condition.
+//----------------------------------------------------------------------------
+static int HistoryKernel(const unsigned char * Data, int Depth, int Iterations)
+{
+    const unsigned char * Data2 = Data == Pattern ? Pattern2 : Data;
+    const unsigned char * Fill = Ones;
+    int i, k, t = 0;
+
+    for (i=0;i<Iterations;i++){
+        if (Data[i & (PATTERN_SIZE-1)]){
+            t += 3;
+        }else{
+            t ^= 5;
+        }
+        for (k=0;k<Depth;k++){
+            if (Fill[k]){
+                t += 1;
+            }else{
+                t ^= 9;
+            }
+        }
+        if (Data2[i & (PATTERN_SIZE-1)]){
+            t += 7;
+        }else{
+            t ^= 11;
+        }
+    }
+    return t;
+}
+
+//----------------------------------------------------------------------------
+// Indirect calls, cycling through a sequence of 256 random targets.
+//----------------------------------------------------------------------------
+#define TARGET(n) static int Target##n(int t) { return (t ^ 0##n) + 1; }
+#define TARGETS8(h) TARGET(h##0) TARGET(h##1) TARGET(h##2) TARGET(h##3) \
+                    TARGET(h##4) TARGET(h##5) TARGET(h##6) TARGET(h##7)
+#define TARGET_PTRS8(h) Target##h##0, Target##h##1, Target##h##2, Target##h##3, \
+                        Target##h##4, Target##h##5, Target##h##6, Target##h##7,
+
+TARGETS8(0) TARGETS8(1) TARGETS8(2) TARGETS8(3)
+TARGETS8(4) TARGETS8(5) TARGETS8(6) TARGETS8(7)
+
+static int (* const Targets[MAX_TARGETS])(int) = {
+    TARGET_PTRS8(0) TARGET_PTRS8(1) TARGET_PTRS8(2) TARGET_PTRS8(3)
+    TARGET_PTRS8(4) TARGET_PTRS8(5) TARGET_PTRS8(6) TARGET_PTRS8(7)
+};
+
+static int IndirectKernel(const unsigned char * Data, int Param, int Iterations)
+{
+    int i, t = 0;
+    for (i=0;i<Iterations;i++){
+        t = Targets[Data[i & 255]](t);
+    }
+    return t;
+}
+
+//----------------------------------------------------------------------------
+// Time a kernel.  Returns ns per branch, and branch misses per branch if the
+// counters are available (otherwise -1)
+//----------------------------------------------------------------------------
+static double TimeKernel(BranchKernel_t Kernel, const unsigned char * Data, int Param,
+                         int Iterations, int BranchesPerIter, double * Misses)
+{
+    Counters_t Counts;
+    double start, duration, Best = 1e9;
+    double NumBranches = (double)Iterations * BranchesPerIter;
+    int r;
+
+    *Misses = -1;
+    BranchSink = Kernel(Data, Param, Iterations/16); // Warm up, and train the predictor
+
+    // Best of three, as the time based miss estimates are sensitive to noise.
+    for (r=0;r<3;r++){
+        CountersStart();
+        start = GetTimeSec();
+        BranchSink = Kernel(Data, Param, Iterations);
+        duration = GetTimeSec()-start;
+        CountersRead(&Counts);
+        if (duration < Best){
+            Best = duration;
+            *Misses = Counts.BranchMisses >= 0 ? Counts.BranchMisses / NumBranches : -1;
+        }
+    }
+    return Best * 1e9 / NumBranches;
+}
+
+//----------------------------------------------------------------------------
+// Misses per branch, from the counters, or estimated from how much slower
+// than the always predicted baseline a kernel ran.
+//----------------------------------------------------------------------------
+static double MissRate(double Ns, double BaseNs, double Misses)
+{
+    if (Misses >= 0) return Misses;
+    if (MissPenaltyNs <= 0) return 0;
+    return (Ns-BaseNs) / MissPenaltyNs;
+}
+
+static void PrintHeader(const char * Title, const char * ParamName)
+{
+    Counters_t Counts;
+    int core = CurrentCore();
+    CountersStart();
+    CountersRead(&Counts);
+    printf("%s, core %d (%s)\n", Title, core, CoreClass(core));
+    printf("  %10s  ns/branch  %s\n", ParamName,
+        Counts.BranchMisses >= 0 ? "miss/branch" : "miss/branch (estimated from time)");
+}
+
+//----------------------------------------------------------------------------
+// Cost of a mispredict, from a branch that is never predicted versus one that
+// always is.  Used for estimating misses when we have no counters.
+//----------------------------------------------------------------------------
+static void MeasureMissPenalty(void)
+{
+    double Misses, NsRandom, NsConst;
+    if (MissPenaltyNs > 0) return;
+    FillPattern(PATTERN_SIZE, 2);
+    NsConst = TimeKernel(PeriodKernel, Zeros, PATTERN_SIZE-1, BRANCHES_PER_RUN, 1, &Misses);
+    NsRandom = TimeKernel(PeriodKernel, Pattern, PATTERN_SIZE-1, BRANCHES_PER_RUN, 1, &Misses);
+    MissPenaltyNs = (NsRandom - NsConst) / 0.5;
+    printf("Mispredict penalty approx %5.2f ns\n", MissPenaltyNs);
+}
+
+//----------------------------------------------------------------------------
+// Sweep the pattern period of a single branch.  Returns the longest period
+// that the predictor learns.  The sweeps all return the largest size that
+// stays under PREDICTED_MISS_RATE.
+//----------------------------------------------------------------------------
+double BranchPeriodTest(void)
+{
+    double Ns, BaseNs, Misses, Rate;
+    int Period, Learned = 0;
+
+    MeasureMissPenalty();
+    PrintHeader("Branch pattern period", "period");
+    FillPattern(PATTERN_SIZE, 2);
+    BaseNs = TimeKernel(PeriodKernel, Zeros, PATTERN_SIZE-1, BRANCHES_PER_RUN, 1, &Misses);
+
+    for (Period=2;Period<=PATTERN_SIZE;Period *= 2){
+        Ns = TimeKernel(PeriodKernel, Pattern, Period-1, BRANCHES_PER_RUN, 1, &Misses);
+        Rate = MissRate(Ns, BaseNs, Misses);
+        printf("  %10d  %9.3f  %6.3f\n", Period, Ns, Rate);
+        if (Rate < PREDICTED_MISS_RATE) Learned = Period;
+    }
+    return Learned;
+}
+
+//----------------------------------------------------------------------------
+// Sweep the number of static branches, each with its own pattern.  Returns
+// the most branches that can all be tracked at once.
+//----------------------------------------------------------------------------
+double BranchStaticTest(void)
+{
+    double Ns, BaseNs, Misses, Rate;
+    int a, Learned = 0;
+
+    MeasureMissPenalty();
+    PrintHeader("Static branch count", "branches");
+    FillPattern(4*MAX_STATIC, 2);
+
+    for (a=0;a<(int)(sizeof(StaticKernels)/sizeof(StaticKernels[0]));a++){
+        int Num = StaticKernels[a].NumBranches;
+        int Iterations = BRANCHES_PER_RUN/Num;
+        BaseNs = TimeKernel(StaticKernels[a].Kernel, Zeros, 0, Iterations, Num, &Misses);
+        Ns = TimeKernel(StaticKernels[a].Kernel, Pattern, 0, Iterations, Num, &Misses);
+        Rate = MissRate(Ns, BaseNs, Misses);
+        printf("  %10d  %9.3f  %6.3f\n", Num, Ns, Rate);
+        if (Rate < PREDICTED_MISS_RATE) Learned = Num;
+    }
+    return Learned;
+}
+
+//----------------------------------------------------------------------------
+// Sweep how many branches lie between a random branch and the branch that
+// repeats its outcome.  Returns the longest distance over which the second
+// branch is still predicted.
+//----------------------------------------------------------------------------
+double BranchHistoryTest(void)
+{
+    double Ns, BaseNs, Misses, Rate;
+    int Depth, Learned = 0;
+
+    MeasureMissPenalty();
+    PrintHeader("Branch history length (misses per iteration of the far branch)", "distance");
+    FillPattern(PATTERN_SIZE, 2);
+    memset(Ones, 1, sizeof(Ones));
+
+    for (Depth=1;Depth<=MAX_DEPTH;Depth *= 2){
+        // Each fill iteration adds two branches to the history, the test and the loop.
+        int PerIter = 2*Depth+2;
+        int Iterations = BRANCHES_PER_RUN/PerIter;
+        BaseNs = TimeKernel(HistoryKernel, Zeros, Depth, Iterations, PerIter, &Misses);
+        Ns = TimeKernel(HistoryKernel, Pattern, Depth, Iterations, PerIter, &Misses);
+
+        // Per iteration, the first branch misses half the time.  Anything
+        // more is the second branch not being predicted.
+        Rate = MissRate(Ns, BaseNs, Misses)*PerIter - 0.5;
+        if (Rate < 0) Rate = 0;
+        printf("  %10d  %9.3f  %6.3f\n", 2*Depth+1, Ns, Rate);
+        if (Rate < PREDICTED_MISS_RATE) Learned = 2*Depth+1;
+    }
+    return Learned;
+}
+
+//----------------------------------------------------------------------------
+// Sweep the number of targets of an indirect call.  Returns the most targets
+// for which the call is still predicted.
+//----------------------------------------------------------------------------
+double BranchIndirectTest(void)
+{
+    double Ns, BaseNs, Misses, Rate;
+    int NumTargets, Learned = 0;
+
+    MeasureMissPenalty();
+    PrintHeader("Indirect branch targets", "targets");
+    BaseNs = TimeKernel(IndirectKernel, Zeros, 0, BRANCHES_PER_RUN, 1, &Misses);
+
+    for (NumTargets=1;NumTargets<=MAX_TARGETS;NumTargets *= 2){
+        FillPattern(256, NumTargets);
+        Ns = TimeKernel(IndirectKernel, Pattern, 0, BRANCHES_PER_RUN, 1, &Misses);
+        Rate = MissRate(Ns, BaseNs, Misses);
+        printf("  %10d  %9.3f  %6.3f\n", NumTargets, Ns, Rate);
+        if (Rate < PREDICTED_MISS_RATE) Learned = NumTargets;
+    }
+    return Learned;
+}
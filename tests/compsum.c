@@ -0,0 +1,231 @@
+//----------------------------------------------------------------------------
+// Accuracy versus speed of different ways of summing a lot of floats.  Same
+// sum of squares as strided_sum.c, with the error of each method measured
+// against a long double reference.
+//
+// Must be compiled with strict floating point (no -ffast-math), or the
+// compiler optimizes the compensation in Kahan and Neumaier summation away.
+//----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "perftest.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define HAVE_SSE2 1
+#endif
+
+#define NUM_ELEMENTS (1024*1024)
+#define NUM_PASSES 20
+#define PAIRWISE_BLOCK 128
+#define SIMD_BLOCK 1024
+
+typedef double (*FloatSum_t)(const float * arr, int size);
+
+static thread_local float * Array;
+volatile double CompSumSink;
+
+//----------------------------------------------------------------------------
+// Add up one float at a time in a float, like most code does.
+//----------------------------------------------------------------------------
+static double SumNaive(const float * arr, int size)
+{
+    float sum = 0;
+    int i;
+    for (i=0;i<size;i++) sum += arr[i]*arr[i];
+    return sum;
+}
+
+//----------------------------------------------------------------------------
+// Float elements, double sum.
+//----------------------------------------------------------------------------
+static double SumDouble(const float * arr, int size)
+{
+    double sum = 0;
+    int i;
+    for (i=0;i<size;i++) sum += (double)(arr[i]*arr[i]);
+    return sum;
+}
+
+//----------------------------------------------------------------------------
+// Kahan summation, carrying the low bits lost in each add.  The sum is a
+// float, but the bits carried are added back in double at the end, else
+// rounding the result to float loses what they gained.
+//----------------------------------------------------------------------------
+static double SumKahan(const float * arr, int size)
+{
+    float sum = 0, c = 0;
+    int i;
+    for (i=0;i<size;i++){
+        float y = arr[i]*arr[i] - c;
+        float t = sum + y;
+        c = (t - sum) - y;
+        sum = t;
+    }
+    return (double)sum - c;
+}
+
+//----------------------------------------------------------------------------
+// Neumaier's version of Kahan, which also works when the term is bigger
+// than the sum so far.
+//----------------------------------------------------------------------------
+static double SumNeumaier(const float * arr, int size)
+{
+    float sum = 0, c = 0;
+    int i;
+    for (i=0;i<size;i++){
+        float x = arr[i]*arr[i];
+        float t = sum + x;
+        if (fabsf(sum) >= fabsf(x)){
+            c += (sum - t) + x;
+        }else{
+            c += (x - t) + sum;
+        }
+        sum = t;
+    }
+    return (double)sum + c;
+}
+
+//----------------------------------------------------------------------------
+// Pairwise summation.  Error grows with log(n) instead of n.  Blocks at the
+// bottom are summed straight, or the recursion costs more than the adding.
+//----------------------------------------------------------------------------
+static float PairwiseRecurse(const float * arr, int size)
+{
+    if (size <= PAIRWISE_BLOCK){
+        float sum = 0;
+        int i;
+        for (i=0;i<size;i++) sum += arr[i]*arr[i];
+        return sum;
+    }else{
+        int half = size/2;
+        return PairwiseRecurse(arr, half) + PairwiseRecurse(arr+half, size-half);
+    }
+}
+
+static double SumPairwise(const float * arr, int size)
+{
+    return PairwiseRecurse(arr, size);
+}
+
+//----------------------------------------------------------------------------
+// Vectorized, with eight float accumulators summed into a double every
+// SIMD_BLOCK elements.  Fast, and each float only sees a short sum.
+//----------------------------------------------------------------------------
+static double SumBlockedSimd(const float * arr, int size)
+{
+    double total = 0;
+    int b, i;
+    for (b=0;b<size;b+=SIMD_BLOCK){
+        int end = b+SIMD_BLOCK < size ? b+SIMD_BLOCK : size;
+#ifdef HAVE_SSE2
+        float Lanes[4];
+        __m128 t0 = _mm_setzero_ps(), t1 = t0;
+        for (i=b;i+8<=end;i+=8){
+            __m128 v0 = _mm_loadu_ps(arr+i);
+            __m128 v1 = _mm_loadu_ps(arr+i+4);
+            t0 = _mm_add_ps(t0, _mm_mul_ps(v0, v0));
+            t1 = _mm_add_ps(t1, _mm_mul_ps(v1, v1));
+        }
+        _mm_storeu_ps(Lanes, _mm_add_ps(t0, t1));
+        for (;i<end;i++) Lanes[0] += arr[i]*arr[i];
+        total += (double)Lanes[0] + Lanes[1] + Lanes[2] + Lanes[3];
+#else
+        float Lanes[8] = {0};
+        int k;
+        for (i=b;i+8<=end;i+=8){
+            for (k=0;k<8;k++) Lanes[k] += arr[i+k]*arr[i+k];
+        }
+        for (;i<end;i++) Lanes[0] += arr[i]*arr[i];
+        for (k=0;k<8;k++) total += Lanes[k];
+#endif
+    }
+    return total;
+}
+
+static const struct {
+    const char * Name;
+    FloatSum_t Sum;
+}Methods[] = {
+    {"naive float   ", SumNaive},
+    {"double sum    ", SumDouble},
+    {"kahan         ", SumKahan},
+    {"neumaier      ", SumNeumaier},
+    {"pairwise      ", SumPairwise},
+    {"blocked simd  ", SumBlockedSimd},
+};
+#define NUM_METHODS (int)(sizeof(Methods)/sizeof(Methods[0]))
+
+//----------------------------------------------------------------------------
+// The same float squares the methods add, so what's left is the error of
+// the summing, not of rounding the squares.  Summing those with Neumaier in
+// long double is as good as exact for these sizes.  (On MSVC, long double is
+// only a double, but still far more accurate than any of the float methods)
+//----------------------------------------------------------------------------
+static double ReferenceSum(const float * arr, int size)
+{
+    long double sum = 0, c = 0;
+    int i;
+    for (i=0;i<size;i++){
+        long double x = (float)(arr[i]*arr[i]);
+        long double t = sum + x;
+        if (fabsl(sum) >= fabsl(x)){
+            c += (sum - t) + x;
+        }else{
+            c += (x - t) + sum;
+        }
+        sum = t;
+    }
+    return (double)(sum + c);
+}
+
+//----------------------------------------------------------------------------
+// Time each method and work out its error.  Returns how many times slower
+// Kahan summation is than the naive loop.
+//----------------------------------------------------------------------------
+double CompensatedSumTest(void)
+{
+    Counters_t Counts;
+    double Reference, NaiveRate = 0, KahanRate = 1;
+    int core = CurrentCore();
+    int a, p;
+
+    if (!Array){
+        unsigned r = 12345;
+        Array = (float *)malloc(NUM_ELEMENTS*sizeof(float));
+        if (!Array){
+            printf("Failed to allocate summation array\n");
+            exit(-1);
+        }
+        for (a=0;a<NUM_ELEMENTS;a++){
+            r = r * 1103515245 + 12345;
+            Array[a] = (float)((r >> 8) & 0xffff) / 32768.0f - 1.0f;
+        }
+    }
+
+    Reference = ReferenceSum(Array, NUM_ELEMENTS);
+    printf("Summing %d squares, core %d (%s), reference sum %.6f\n",
+            NUM_ELEMENTS, core, CoreClass(core), Reference);
+    printf("  method         elements/cycle  relative error\n");
+
+    for (a=0;a<NUM_METHODS;a++){
+        double start, sum = 0, Rate, Error;
+        CountersStart();
+        start = GetTimeSec();
+        for (p=0;p<NUM_PASSES;p++){
+            sum = Methods[a].Sum(Array, NUM_ELEMENTS);
+        }
+        start = GetTimeSec()-start;
+        CountersRead(&Counts);
+        CompSumSink = sum;
+
+        Rate = (double)NUM_ELEMENTS * NUM_PASSES / ElapsedCycles(&Counts, start);
+        Error = fabs(sum - Reference) / Reference;
+        printf("  %s %14.3f  %14.3g\n", Methods[a].Name, Rate, Error);
+
+        if (Methods[a].Sum == SumNaive) NaiveRate = Rate;
+        if (Methods[a].Sum == SumKahan) KahanRate = Rate;
+    }
+    return NaiveRate / KahanRate;
+}
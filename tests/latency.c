@@ -0,0 +1,207 @@
+//----------------------------------------------------------------------------
+// Instruction latency and throughput.  Like strided_sum, this times one
+// dependency chain against several independent ones, but for a table of
+// operations.  One chain gives the latency, and the number of chains where
+// it stops getting faster tells how many accumulators a loop needs to keep
+// that unit busy.
+//----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "perftest.h"
+
+// Keep the compiler from folding or reassociating a dependency chain,
+// without adding any instructions to it.  MSVC has no equivalent, but it
+// doesn't reassociate floating point either.
+#if defined(__GNUC__)
+    #define OPAQUE_INT(x) __asm__ volatile("" : "+r"(x))
+    #if defined(__x86_64__) || defined(__i386__)
+        #define OPAQUE_FP(x) __asm__ volatile("" : "+x"(x))
+    #else
+        #define OPAQUE_FP(x) __asm__ volatile("" : "+w"(x))
+    #endif
+#else
+    #define OPAQUE_INT(x)
+    #define OPAQUE_FP(x)
+#endif
+
+// Without compiling for FMA, build the FMA kernels for it anyway and only
+// run them if the CPU has it.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(__FMA__)
+    #define FMA_TARGET __attribute__((target("fma")))
+    #define HAVE_FMA() __builtin_cpu_supports("fma")
+    #define FMA(a,b,c) __builtin_fma(a,b,c)
+#elif defined(__FMA__) || defined(__aarch64__) || defined(__ARM_FEATURE_FMA)
+    #define FMA_TARGET
+    #define HAVE_FMA() 1
+    #define FMA(a,b,c) fma(a,b,c)
+#else
+    #define FMA_TARGET
+    #define HAVE_FMA() 0
+    #define FMA(a,b,c) ((a)*(b)+(c))
+#endif
+
+#define UNROLL 4
+#define NUM_WIDTHS 7
+#define MAX_CHAINS 12  // More would run out of registers on x86
+static const int Widths[NUM_WIDTHS] = {1, 2, 3, 4, 6, 8, 12};
+
+typedef unsigned long long u64;
+typedef void (*ChainKernel_t)(int Iterations);
+
+volatile double Operand = 1.0;  // volatile so the compiler can't fold it in.
+u64 LatencySink[MAX_CHAINS];
+static thread_local void * LoadSlots[MAX_CHAINS*8];  // Each chain's pointer in its own cache line
+
+//----------------------------------------------------------------------------
+// Kernels for N chains of one operation, each step of a chain depending on
+// the result of the previous step.
+//----------------------------------------------------------------------------
+#define CHAIN_KERNEL(NAME, N, ATTR, TYPE, INIT, OP, OPAQUE)      \
+ATTR static void NAME##N(int Iterations)                        \
+{                                                               \
+    TYPE x[N];                                                  \
+    double y = Operand;                                         \
+    int i, k, u;                                                \
+    (void)y;                                                    \
+    FULL_UNROLL                                                 \
+    for (k=0;k<N;k++) x[k] = INIT;                              \
+    for (i=0;i<Iterations;i++){                                 \
+        FULL_UNROLL                                             \
+        for (u=0;u<UNROLL;u++){                                 \
+            FULL_UNROLL                                         \
+            for (k=0;k<N;k++){                                  \
+                x[k] = OP;                                      \
+                OPAQUE(x[k]);                                   \
+            }                                                   \
+        }                                                       \
+    }                                                           \
+    FULL_UNROLL                                                 \
+    for (k=0;k<N;k++) ((TYPE *)LatencySink)[k] = x[k];          \
+}
+
+#define CHAIN_KERNELS(NAME, ATTR, TYPE, INIT, OP, OPAQUE)       \
+    CHAIN_KERNEL(NAME, 1, ATTR, TYPE, INIT, OP, OPAQUE)         \
+    CHAIN_KERNEL(NAME, 2, ATTR, TYPE, INIT, OP, OPAQUE)         \
+    CHAIN_KERNEL(NAME, 3, ATTR, TYPE, INIT, OP, OPAQUE)         \
+    CHAIN_KERNEL(NAME, 4, ATTR, TYPE, INIT, OP, OPAQUE)         \
+    CHAIN_KERNEL(NAME, 6, ATTR, TYPE, INIT, OP, OPAQUE)         \
+    CHAIN_KERNEL(NAME, 8, ATTR, TYPE, INIT, OP, OPAQUE)         \
+    CHAIN_KERNEL(NAME, 12, ATTR, TYPE, INIT, OP, OPAQUE)
+
+#define KERNEL_LIST(NAME) {NAME##1, NAME##2, NAME##3, NAME##4, NAME##6, NAME##8, NAME##12}
+
+CHAIN_KERNELS(IntAdd,  , u64,    k+1,          x[k] + (u64)y,          OPAQUE_INT)
+CHAIN_KERNELS(IntMul,  , u64,    k+3,          x[k] * ((u64)y+2),      OPAQUE_INT)
+// Alternates between two values near 2^20, as c / (c / x) is about x
+CHAIN_KERNELS(IntDiv,  , u64,    1000003+k,    ((u64)y << 40) / x[k],  OPAQUE_INT)
+CHAIN_KERNELS(FpAdd,   , double, k,            x[k] + y,           OPAQUE_FP)
+CHAIN_KERNELS(FpMul,   , double, k+1.5,        x[k] * y,           OPAQUE_FP)
+CHAIN_KERNELS(FpFma, FMA_TARGET, double, k,    FMA(x[k], y, y),    OPAQUE_FP)
+CHAIN_KERNELS(FpDiv,   , double, k+1.5,        y / x[k],           OPAQUE_FP)
+// Converges on 1.0, which takes as long as any other number on the CPUs I've checked.
+CHAIN_KERNELS(FpSqrt,  , double, k+2.0,        sqrt(x[k]),         OPAQUE_FP)
+// Pointer chasing on L1 resident pointers that point to themselves.
+CHAIN_KERNELS(Load,    , void *, &LoadSlots[k*8], *(void **)x[k],  OPAQUE_INT)
+
+typedef struct {
+    const char * Name;
+    int Iterations;   // Enough that each run takes a few milliseconds
+    ChainKernel_t Kernels[NUM_WIDTHS];
+}InstrTest_t;
+
+static const InstrTest_t InstrTests[] = {
+    {"int add ", 1000000, KERNEL_LIST(IntAdd)},
+    {"int mul ", 1000000, KERNEL_LIST(IntMul)},
+    {"int div ",  100000, KERNEL_LIST(IntDiv)},
+    {"fp add  ", 1000000, KERNEL_LIST(FpAdd)},
+    {"fp mul  ", 1000000, KERNEL_LIST(FpMul)},
+    {"fp fma  ", 1000000, KERNEL_LIST(FpFma)},
+    {"fp div  ",  200000, KERNEL_LIST(FpDiv)},
+    {"fp sqrt ",  200000, KERNEL_LIST(FpSqrt)},
+    {"load    ", 1000000, KERNEL_LIST(Load)},
+};
+#define NUM_INSTR_TESTS (int)(sizeof(InstrTests)/sizeof(InstrTests[0]))
+
+//----------------------------------------------------------------------------
+// Cycles per operation of a kernel, best of a few runs.
+//----------------------------------------------------------------------------
+static double CyclesPerOp(ChainKernel_t Kernel, int Iterations, int NumChains)
+{
+    Counters_t Counts;
+    double start, Cycles, Best = 1e30;
+    int r;
+
+    Kernel(Iterations/10); // Warm up
+    for (r=0;r<3;r++){
+        CountersStart();
+        start = GetTimeSec();
+        Kernel(Iterations);
+        start = GetTimeSec()-start;
+        CountersRead(&Counts);
+        Cycles = ElapsedCycles(&Counts, start);
+        if (Cycles < Best) Best = Cycles;
+    }
+    return Best / ((double)Iterations * UNROLL * NumChains);
+}
+
+//----------------------------------------------------------------------------
+// Run the table.  Returns how many independent chains it takes to get the
+// best throughput for floating point adds (the usual summing loop)
+//----------------------------------------------------------------------------
+double InstrLatencyTest(void)
+{
+    Counters_t Counts;
+    double FpAddChains = 0;
+    int core = CurrentCore();
+    int a, w;
+
+    for (a=0;a<MAX_CHAINS;a++) LoadSlots[a*8] = &LoadSlots[a*8];
+
+    CountersStart();
+    CountersRead(&Counts);
+    printf("Instruction latency and throughput, core %d (%s), ", core, CoreClass(core));
+    if (Counts.Cycles >= 0){
+        printf("cycles from counter\n");
+    }else{
+        printf("cycles from clock estimate of %4.2f GHz\n", EstimateClockHz()/1e9);
+    }
+    printf("  op        latency   ops/cycle with N independent chains\n");
+    printf("            (cycles)");
+    for (w=0;w<NUM_WIDTHS;w++) printf(" %5d",Widths[w]);
+    printf("   best chains needed\n");
+
+    for (a=0;a<NUM_INSTR_TESTS;a++){
+        const InstrTest_t * Test = &InstrTests[a];
+        double Thru[NUM_WIDTHS];
+        double Latency, Best = 0;
+        int Needed = 0;
+
+        if (Test->Kernels[0] == FpFma1 && !HAVE_FMA()){
+            printf("  %s  (no FMA on this CPU)\n", Test->Name);
+            continue;
+        }
+
+        for (w=0;w<NUM_WIDTHS;w++){
+            Thru[w] = 1.0 / CyclesPerOp(Test->Kernels[w], Test->Iterations, Widths[w]);
+            if (Thru[w] > Best) Best = Thru[w];
+        }
+        Latency = 1.0 / Thru[0];
+
+        // Fewest chains that get within 10% of the best throughput.
+        for (w=0;w<NUM_WIDTHS;w++){
+            if (Thru[w] >= Best*0.9){
+                Needed = Widths[w];
+                break;
+            }
+        }
+
+        printf("  %s  %7.2f  ", Test->Name, Latency);
+        for (w=0;w<NUM_WIDTHS;w++) printf(" %5.2f",Thru[w]);
+        printf("  %5.2f  %4d\n", Best, Needed);
+
+        if (Test->Kernels[0] == FpAdd1) FpAddChains = Needed;
+    }
+    return FpAddChains;
+}
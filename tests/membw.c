@@ -0,0 +1,163 @@
+//----------------------------------------------------------------------------
+// STREAM style memory bandwidth tests: read, write, copy and triad, with
+// non-temporal store variants.  Each thread works on its own arrays, so
+// running these with several -a options gives the aggregate bandwidth
+// when that many cores compete for memory.  The threads don't wait for
+// each other before timing, so the runs only mostly overlap, and the
+// total is approximate.
+//----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "perftest.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define HAVE_NT_STORES 1
+#endif
+
+// 32 megabytes per array, so three arrays are well past any last level cache.
+#define MEMBW_ELEMENTS (4*1024*1024)
+#define MEMBW_PASSES 20
+
+enum {BW_READ, BW_WRITE, BW_COPY, BW_TRIAD, BW_WRITE_NT, BW_COPY_NT, BW_TRIAD_NT};
+
+// Bytes moved per element, counted the way STREAM counts them.
+static const int BytesPerElement[] = {8, 8, 16, 24, 8, 16, 24};
+
+static thread_local char * ArrBlock;   // As allocated, for freeing
+static thread_local double * ArrA;
+static thread_local double * ArrB;
+static thread_local double * ArrC;
+volatile double MemBwSink;
+
+//----------------------------------------------------------------------------
+// Allocate this thread's arrays, in one block, 64 byte aligned for the
+// streaming stores.
+//----------------------------------------------------------------------------
+static void MakeArrays(void)
+{
+    char * p;
+    int a;
+
+    ArrBlock = (char *)malloc(3*MEMBW_ELEMENTS*sizeof(double)+64);
+    if (!ArrBlock){
+        printf("Failed to allocate memory bandwidth test arrays\n");
+        exit(-1);
+    }
+    p = ArrBlock + 64 - ((size_t)ArrBlock & 63);
+    ArrA = (double *)p;
+    ArrB = ArrA + MEMBW_ELEMENTS;
+    ArrC = ArrB + MEMBW_ELEMENTS;
+    // Touch everything once so page faults don't get counted in the test.
+    for (a=0;a<MEMBW_ELEMENTS;a++){
+        ArrA[a] = 1.0;
+        ArrB[a] = 2.0;
+        ArrC[a] = 0.5;
+    }
+}
+
+static void FreeArrays(void)
+{
+    free(ArrBlock);
+    ArrBlock = NULL;
+    ArrA = ArrB = ArrC = NULL;
+}
+
+//----------------------------------------------------------------------------
+// One pass of a kernel over the arrays.
+//----------------------------------------------------------------------------
+static void BwPass(int Kernel, double * a, double * b, double * c, double s)
+{
+    int i;
+    switch(Kernel){
+        case BW_READ:{
+            // Several sums, so add latency doesn't limit the read rate.
+            double s1=0, s2=0, s3=0, s4=0;
+            for (i=0;i<MEMBW_ELEMENTS;i+=4){
+                s1 += a[i];
+                s2 += a[i+1];
+                s3 += a[i+2];
+                s4 += a[i+3];
+            }
+            MemBwSink = s1+s2+s3+s4;
+            break;
+        }
+        case BW_WRITE:
+            for (i=0;i<MEMBW_ELEMENTS;i++) a[i] = s;
+            break;
+        case BW_COPY:
+            for (i=0;i<MEMBW_ELEMENTS;i++) a[i] = b[i];
+            break;
+        case BW_TRIAD:
+            for (i=0;i<MEMBW_ELEMENTS;i++) a[i] = b[i] + s*c[i];
+            break;
+
+#ifdef HAVE_NT_STORES
+        // Streaming stores skip the read for ownership of the destination lines.
+        case BW_WRITE_NT:{
+            __m128d vs = _mm_set1_pd(s);
+            for (i=0;i<MEMBW_ELEMENTS;i+=2) _mm_stream_pd(a+i, vs);
+            _mm_sfence();
+            break;
+        }
+        case BW_COPY_NT:
+            for (i=0;i<MEMBW_ELEMENTS;i+=2) _mm_stream_pd(a+i, _mm_load_pd(b+i));
+            _mm_sfence();
+            break;
+        case BW_TRIAD_NT:{
+            __m128d vs = _mm_set1_pd(s);
+            for (i=0;i<MEMBW_ELEMENTS;i+=2){
+                _mm_stream_pd(a+i, _mm_add_pd(_mm_load_pd(b+i), _mm_mul_pd(vs, _mm_load_pd(c+i))));
+            }
+            _mm_sfence();
+            break;
+        }
+#else
+        // No streaming stores on this build, so these are the same as the regular ones.
+        case BW_WRITE_NT:
+            BwPass(BW_WRITE, a, b, c, s);
+            break;
+        case BW_COPY_NT:
+            BwPass(BW_COPY, a, b, c, s);
+            break;
+        case BW_TRIAD_NT:
+            BwPass(BW_TRIAD, a, b, c, s);
+            break;
+#endif
+    }
+}
+
+//----------------------------------------------------------------------------
+// Run a kernel a number of times, return bandwidth in GB/s
+//----------------------------------------------------------------------------
+static double RunMemBw(int Kernel)
+{
+    double start, duration;
+    int p;
+
+    MakeArrays();
+    BwPass(Kernel, ArrA, ArrB, ArrC, 3.0); // Warm up
+
+    start = GetTimeSec();
+    for (p=0;p<MEMBW_PASSES;p++){
+        // Alternate direction of copies so the data stays the same.
+        if (p & 1){
+            BwPass(Kernel, ArrB, ArrA, ArrC, 3.0);
+        }else{
+            BwPass(Kernel, ArrA, ArrB, ArrC, 3.0);
+        }
+    }
+    duration = GetTimeSec()-start;
+    FreeArrays();
+
+    return (double)BytesPerElement[Kernel] * MEMBW_ELEMENTS * MEMBW_PASSES / duration / 1e9;
+}
+
+double MemBwRead(void)    { return RunMemBw(BW_READ); }
+double MemBwWrite(void)   { return RunMemBw(BW_WRITE); }
+double MemBwCopy(void)    { return RunMemBw(BW_COPY); }
+double MemBwTriad(void)   { return RunMemBw(BW_TRIAD); }
+double MemBwWriteNt(void) { return RunMemBw(BW_WRITE_NT); }
+double MemBwCopyNt(void)  { return RunMemBw(BW_COPY_NT); }
+double MemBwTriadNt(void) { return RunMemBw(BW_TRIAD_NT); }
@@ -0,0 +1,178 @@
+//----------------------------------------------------------------------------
+// The 2D pentomino problem as exact cover, solved with Knuth's dancing links
+// (Algorithm X).  A textbook algorithm to compare the hand tuned searches in
+// pentominos.c against.
+//
+// There is a column for each of the 60 squares (all the boards have 60) and
+// each of the 12 pieces, and a row for each placement of a piece.  The
+// search always covers the column with the fewest rows left.  Nodes are
+// indexes into one array rather than pointers, so they are small and close
+// together.
+//----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include "perftest.h"
+
+#define NUM_SQUARES 60
+#define NUM_COLS (NUM_SQUARES+12)
+#define MAX_ROWS 4096
+
+typedef struct {
+    int L, R, U, D;
+    int Col;
+}Node_t;
+
+// Node 0 is the root, nodes 1 to NUM_COLS the column headers.
+static thread_local Node_t * Nodes;
+static thread_local int ColSize[NUM_COLS+1];
+static thread_local int DlxSolutions;
+static thread_local int DlxPlaces;
+
+//----------------------------------------------------------------------------
+// Take a column out, along with every row that has a one in it.
+//----------------------------------------------------------------------------
+static void Cover(int c)
+{
+    int i, j;
+    Nodes[Nodes[c].R].L = Nodes[c].L;
+    Nodes[Nodes[c].L].R = Nodes[c].R;
+    for (i=Nodes[c].D;i!=c;i=Nodes[i].D){
+        for (j=Nodes[i].R;j!=i;j=Nodes[j].R){
+            Nodes[Nodes[j].D].U = Nodes[j].U;
+            Nodes[Nodes[j].U].D = Nodes[j].D;
+            ColSize[Nodes[j].Col] -= 1;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Put it back, in exactly the reverse order.
+//----------------------------------------------------------------------------
+static void Uncover(int c)
+{
+    int i, j;
+    for (i=Nodes[c].U;i!=c;i=Nodes[i].U){
+        for (j=Nodes[i].L;j!=i;j=Nodes[j].L){
+            ColSize[Nodes[j].Col] += 1;
+            Nodes[Nodes[j].D].U = j;
+            Nodes[Nodes[j].U].D = j;
+        }
+    }
+    Nodes[Nodes[c].R].L = c;
+    Nodes[Nodes[c].L].R = c;
+}
+
+//----------------------------------------------------------------------------
+// Algorithm X.
+//----------------------------------------------------------------------------
+static void Search(void)
+{
+    int c = 0, r, j, Best = MAX_ROWS;
+
+    if (Nodes[0].R == 0){
+        DlxSolutions += 1;
+        return;
+    }
+
+    // Column with the fewest rows.  If one has none, this is a dead end.
+    for (j=Nodes[0].R;j!=0;j=Nodes[j].R){
+        if (ColSize[j] < Best){
+            Best = ColSize[j];
+            c = j;
+            if (Best == 0) return;
+        }
+    }
+
+    Cover(c);
+    for (r=Nodes[c].D;r!=c;r=Nodes[r].D){
+        DlxPlaces += 1;
+        for (j=Nodes[r].R;j!=r;j=Nodes[j].R) Cover(Nodes[j].Col);
+        Search();
+        for (j=Nodes[r].L;j!=r;j=Nodes[j].L) Uncover(Nodes[j].Col);
+    }
+    Uncover(c);
+}
+
+//----------------------------------------------------------------------------
+// Link up the nodes for a set of rows.
+//----------------------------------------------------------------------------
+static void BuildLinks(PentoRow_t * Rows, int NumRows)
+{
+    int n, r, k;
+
+    for (n=0;n<=NUM_COLS;n++){
+        Nodes[n].L = n == 0 ? NUM_COLS : n-1;
+        Nodes[n].R = n == NUM_COLS ? 0 : n+1;
+        Nodes[n].U = Nodes[n].D = n;
+        Nodes[n].Col = n;
+        ColSize[n] = 0;
+    }
+
+    for (r=0;r<NumRows;r++){
+        int Cols[6];
+        int First = n;
+        for (k=0;k<5;k++) Cols[k] = Rows[r].Squares[k]+1;
+        Cols[5] = NUM_SQUARES+1+Rows[r].Piece;
+
+        for (k=0;k<6;k++,n++){
+            int c = Cols[k];
+            Nodes[n].Col = c;
+            Nodes[n].L = k == 0 ? First+5 : n-1;
+            Nodes[n].R = k == 5 ? First : n+1;
+            Nodes[n].U = Nodes[c].U;
+            Nodes[n].D = c;
+            Nodes[Nodes[c].U].D = n;
+            Nodes[c].U = n;
+            ColSize[c] += 1;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Solve it, and time TryPieces on the same board.  The two make different
+// numbers of placements, so only the times compare.  Returns how many times
+// faster dancing links is, or -1 if it didn't find the same solutions.
+//----------------------------------------------------------------------------
+double PentominoDlxTest(void)
+{
+    static thread_local PentoRow_t * Rows;
+    double Times[2];
+    int NumRows, Solutions;
+
+    if (!Rows){
+        Rows = (PentoRow_t *)malloc(MAX_ROWS*sizeof(PentoRow_t));
+        Nodes = (Node_t *)malloc((NUM_COLS+1+MAX_ROWS*6)*sizeof(Node_t));
+        if (!Rows || !Nodes){
+            printf("Failed to allocate exact cover nodes\n");
+            exit(-1);
+        }
+    }
+
+    NumRows = PentominoRows(Rows, MAX_ROWS);
+    if (NumRows < 0){
+        printf("Too many exact cover rows\n");
+        return -1;
+    }
+    BuildLinks(Rows, NumRows);
+
+    Times[0] = GetTimeSec();
+    Solutions = PentominoBenchmark();
+    Times[0] = GetTimeSec()-Times[0];
+
+    DlxSolutions = 0;
+    DlxPlaces = 0;
+    Times[1] = GetTimeSec();
+    Search();
+    Times[1] = GetTimeSec()-Times[1];
+
+    printf("Dancing links against TryPieces, %s board\n", PentominoBoardName(PentominoBoardNum()));
+    printf("  TryPieces:     %7.3f s\n", Times[0]);
+    printf("  dancing links: %7.3f s  (%d rows, %d placements)\n", Times[1], NumRows, DlxPlaces);
+
+    if (Solutions != PentominoBoardSolutions()) return -1;
+    if (DlxSolutions != Solutions){
+        printf("Exact cover solver found %d solutions\n", DlxSolutions);
+        return -1;
+    }
+    return Times[0] / Times[1];
+}
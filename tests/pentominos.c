@@ -5,12 +5,16 @@
 // Dec 30 2000 Matthias Wandel
 //--------------------------------------------------------------------------
 #include <stdio.h>
+#include <stdlib.h>
 #include <memory.h>
 #include <time.h>
 
 #if _WIN32 || _WIN64
     #include <windows.h>
 #endif
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
 
 #include "perftest.h"
 #define COMBINED_CHECK  // Makes it in 48 seconds on my Celeron 500
@@ -70,10 +74,104 @@ thread_local Piece_t Variants[12][8];
 thread_local int NumVariants[12];   // Number of variants.
 
 typedef struct {
-    BYTE Pos[12][8];   // Grid for where the pieces go.
-    BYTE Placed[12];   // These pieces are already placed.
+    const char * Name;
+    int Width, Height;
+    int HoleX, HoleY, HoleW, HoleH;  // Squares left out of the middle.
+    int Solutions;  // Known number, with the L piece kept to one way round.
+    int Distinct;   // Not counting rotations and mirror images.
+}Board_t;
+
+static const Board_t Boards[] = {
+    {"6x10",  6, 10,  0, 0, 0, 0,  2339, 2339},
+    {"5x12",  5, 12,  0, 0, 0, 0,  1010, 1010},
+    {"4x15",  4, 15,  0, 0, 0, 0,   368,  368},
+    {"3x20",  3, 20,  0, 0, 0, 0,     2,    2},
+    // A square has twice the symmetries of a rectangle, so the L piece
+    // alone doesn't rule out mirror images.  65 solutions found twice.
+    {"8x8 less centre", 8, 8,  3, 3, 2, 2,  130, 65},
+};
+#define NUM_BOARDS (int)(sizeof(Boards)/sizeof(Boards[0]))
+static int BoardNum = 0;
+
+//--------------------------------------------------------------------------
+// Pick the board for the 2D solvers.  Returns FALSE if there is no board n.
+//--------------------------------------------------------------------------
+int PentominoSetBoard(int n)
+{
+    if (n < 0 || n >= NUM_BOARDS) return FALSE;
+    BoardNum = n;
+    return TRUE;
+}
+
+int PentominoBoardNum(void)
+{
+    return BoardNum;
+}
+
+//--------------------------------------------------------------------------
+// Name of board n, or NULL if there is no such board.
+//--------------------------------------------------------------------------
+const char * PentominoBoardName(int n)
+{
+    if (n < 0 || n >= NUM_BOARDS) return NULL;
+    return Boards[n].Name;
+}
+
+//--------------------------------------------------------------------------
+// How many solutions the current board should have.
+//--------------------------------------------------------------------------
+int PentominoBoardSolutions(void)
+{
+    return Boards[BoardNum].Solutions;
+}
+
+int PentominoKnownSolutions(int n)
+{
+    return Boards[n].Solutions;
+}
+
+int PentominoBoardDistinct(void)
+{
+    return Boards[BoardNum].Distinct;
+}
+
+//--------------------------------------------------------------------------
+// The byte grid the board is laid out on for TryPieces and the solvers
+// after it.  Rows are Width+1 squares, the first being border, so a piece
+// that sticks out either side of the board runs into a border square.  Row
+// 0, the hole, and everything past the last row is border too.  There has
+// to be room past the last row for reading a piece's worth of rows and an
+// 8 byte word beyond it.
+//--------------------------------------------------------------------------
+#define GRID_SIZE 128
+thread_local int GridStride;  // Width+1
+
+typedef struct {
+    BYTE Pos[GRID_SIZE];  // Grid for where the pieces go, row*GridStride+col.
+    BYTE Placed[12];      // These pieces are already placed.
 }Field_t;
 
+static void MakeGrid(BYTE * Grid)
+{
+    const Board_t * Board = &Boards[BoardNum];
+    int row, col;
+
+    GridStride = Board->Width+1;
+    if ((Board->Height+5)*GridStride+7 > GRID_SIZE){
+        printf("Board %s too big for the byte grid\n", Board->Name);
+        exit(-1);
+    }
+
+    memset(Grid, 0xff, GRID_SIZE);
+    for (row=0;row<Board->Height;row++){
+        for (col=0;col<Board->Width;col++){
+            if (col >= Board->HoleX && col < Board->HoleX+Board->HoleW
+                    && row >= Board->HoleY && row < Board->HoleY+Board->HoleH) continue;
+            Grid[(row+1)*GridStride+col+1] = 0;
+        }
+    }
+}
+
 //--------------------------------------------------------------------------
 // Show a piece.
 //--------------------------------------------------------------------------
@@ -100,10 +198,10 @@ void ShowPiece(Piece_t * Piece)
 void ShowField(Field_t * Field)
 {
     int x,y,a;
-    for (y=12;;){
+    for (y=GRID_SIZE/GridStride;;){
         if (!y--) break;
-        for (x=0;x<8;x++){
-            a = Field->Pos[y][x];
+        for (x=0;x<GridStride;x++){
+            a = Field->Pos[y*GridStride+x];
             if (a == 0){
                 printf(".");
             }else{
@@ -125,19 +223,21 @@ void ShowFancy(Field_t * Field)
 {
     int row,col;
     int r;
+    int Width = Boards[BoardNum].Width;
+    #define AT(row,col) Field->Pos[(row)*GridStride+(col)]
 
-    for (row=10;row>0;row--){
+    for (row=Boards[BoardNum].Height;row>0;row--){
 
         for (r=0;r<2;r++){ // Print the same stuff 3 times for clarity...
-            for (col=1;col<=6;col++){
-                if (Field->Pos[row][col]){
+            for (col=1;col<=Width;col++){
+                if (AT(row,col)){
                     printf("####");
                 }else{
                     printf("    ");
                 }
-                if (col < 6){
-                    if (Field->Pos[row][col] == Field->Pos[row][col+1]){
-                        if (Field->Pos[row][col]){
+                if (col < Width){
+                    if (AT(row,col) == AT(row,col+1)){
+                        if (AT(row,col)){
                             printf("#");
                         }else{
                             printf(":");
@@ -151,9 +251,9 @@ void ShowFancy(Field_t * Field)
         }
 
         if (row > 1){
-            for (col=1;col<=6;col++){
-                if (Field->Pos[row][col] == Field->Pos[row-1][col]){
-                    if (Field->Pos[row][col]){
+            for (col=1;col<=Width;col++){
+                if (AT(row,col) == AT(row-1,col)){
+                    if (AT(row,col)){
                         printf("####");
 
                     }else{
@@ -168,7 +268,7 @@ void ShowFancy(Field_t * Field)
         }
         
     }
-
+    #undef AT
 }
 
 
@@ -225,32 +325,28 @@ thread_local int GlobalSolutions = 0;
 void TryPieces(Field_t * Pre)
 {
     int pn;
-    int BottomFreeRow = 0;
-    int BottomFreeCol = 0;
+    int Free;
+    int BottomFreeRow;
+    int BottomFreeCol;
     int NumPlaced;
+    int S = GridStride;
     Field_t Field;
 
     // Establish left most position in bottom most free row with a free
     // square.  The next piece MUST occupy this - cuts down on duplications.
-    {
-        int row,col;
-        for (row=1;row<=12;row++){
-            for (col=1;col<=6;col++){
-                if (Pre->Pos[row][col] == 0){
-                    BottomFreeRow = row;
-                    BottomFreeCol = col;
-                    goto done;
-                }
-            }
-        }
+    // All that's not free board is taken, so that's the first free byte.
+    for (Free=0;Free<GRID_SIZE;Free++){
+        if (Pre->Pos[Free] == 0) break;
     }
-    done:
+    BottomFreeRow = Free / S;
+    BottomFreeCol = Free % S;
 
     // Count pieces placed so far (need that later)
     NumPlaced = 0;
     for (pn=0;pn<12;pn++){
         if (Pre->Placed[pn]) NumPlaced += 1;
     }
+    STATS_ENTER(NumPlaced);
 
     // Copy field for messing about with.
     Field = *Pre;
@@ -268,16 +364,19 @@ void TryPieces(Field_t * Pre)
         for (pv=0;pv<NumVariants[pn];pv++){
             Piece_t TryPiece;
             int px,py;
+            BYTE * At;
             TryPiece = Variants[pn][pv];
 
             py = BottomFreeRow; // Piece must occupy bottom-most position.
 
             // Loop for piece X (piece Y must be bottom most free)
-            for (px=1;px<=6;px++){
+            for (px=1;px<S;px++){
                 if (px > BottomFreeCol){
                     // Too far to the right.  Could not possibly occupy the spot.
                     break;
                 }
+                STATS_COUNT(Tries);
+                At = &Field.Pos[py*S+px];
 
 #ifdef COMBINED_CHECK
 //#define COMBINED_IF
@@ -285,59 +384,62 @@ void TryPieces(Field_t * Pre)
                     // Combining the first two checks makes it run about 14% faster!
                     // Slightly more speedup by cominging the first 3 conditions, but slower
                     // on 2008 and prior intel CPUs
-                    if (  (*((DWORD *)&(TryPiece.Used[0][0]))& *((DWORD *)&(Field.Pos[py][px])))
+                    if (  (*((DWORD *)&(TryPiece.Used[0][0]))& *((DWORD *)At))
                         |
-                          (*((DWORD *)&(TryPiece.Used[1][0]))& *((DWORD *)&(Field.Pos[py+1][px])))
+                          (*((DWORD *)&(TryPiece.Used[1][0]))& *((DWORD *)(At+S)))
                         ){
                         goto pos_failed;
                     }
 #else
                     if (   *((DWORD *)&(TryPiece.Used[0][0]))
-                         & *((DWORD *)&(Field.Pos[py][px]))
+                         & *((DWORD *)At)
                         ){
                         goto pos_failed;
                     }
 
                     if (   *((DWORD *)&(TryPiece.Used[1][0]))
-                         & *((DWORD *)&(Field.Pos[py+1][px]))){
+                         & *((DWORD *)(At+S))){
                         goto pos_failed;
                     }
 #endif
 
                     if (   *((DWORD *)&(TryPiece.Used[2][0]))
-                         & *((DWORD *)&(Field.Pos[py+2][px]))){
+                         & *((DWORD *)(At+2*S))){
                         goto pos_failed;
                     }
 
                     if (   *((WORD *)&(TryPiece.Used[3][0]))
-                         & *((WORD *)&(Field.Pos[py+3][px]))){
+                         & *((WORD *)(At+3*S))){
                         goto pos_failed;
                     }
 
-                    if (TryPiece.Used[0][4] & Field.Pos[py][px+4] ){
+                    if (TryPiece.Used[0][4] & At[4] ){
                         goto pos_failed;
                     }
 
-                    if (TryPiece.Used[4][0] & Field.Pos[py+4][px] ){
+                    if (TryPiece.Used[4][0] & At[4*S] ){
                         goto pos_failed;
                     }
 
-                    if (TryPiece.Used[0][BottomFreeCol-px] == 0) continue; // does not hit the desired spot.
+                    if (TryPiece.Used[0][BottomFreeCol-px] == 0){
+                        STATS_COUNT(Redundant);
+                        continue; // does not hit the desired spot.
+                    }
 
 
-                    *((DWORD *)&(Field.Pos[py+0][px])) |= *((DWORD *)&(TryPiece.Used[0][0]));
-                                 Field.Pos[py+0][px+4] |= TryPiece.Used[0][4];
-                    *((DWORD *)&(Field.Pos[py+1][px])) |= *((DWORD *)&(TryPiece.Used[1][0]));
-                    *((DWORD *)&(Field.Pos[py+2][px])) |= *((DWORD *)&(TryPiece.Used[2][0]));
-                    *((DWORD *)&(Field.Pos[py+3][px])) |= *((DWORD *)&(TryPiece.Used[3][0]));
-                                 Field.Pos[py+4][px]   |= TryPiece.Used[4][0];
+                    *((DWORD *)(At    )) |= *((DWORD *)&(TryPiece.Used[0][0]));
+                                At[4]    |= TryPiece.Used[0][4];
+                    *((DWORD *)(At+  S)) |= *((DWORD *)&(TryPiece.Used[1][0]));
+                    *((DWORD *)(At+2*S)) |= *((DWORD *)&(TryPiece.Used[2][0]));
+                    *((DWORD *)(At+3*S)) |= *((DWORD *)&(TryPiece.Used[3][0]));
+                                At[4*S]  |= TryPiece.Used[4][0];
 
 #else
 
                     // Loop for row and column trying to place it.
                     for (row=0;row<5;row++){
                         for(col=0;col<5;col++){
-                            if (TryPiece.Used[row][col] & Field.Pos[row+py][col+px]){
+                            if (TryPiece.Used[row][col] & At[row*S+col]){
                                 // There is a conflict.  Position fails.
                                 goto pos_failed;
                             }
@@ -349,7 +451,7 @@ void TryPieces(Field_t * Pre)
                     // Place the piece.
                     for (row=0;row<5;row++){
                         for(col=0;col<5;col++){
-                            Field.Pos[row+py][col+px] |= TryPiece.Used[row][col];
+                            At[row*S+col] |= TryPiece.Used[row][col];
                         }
                     }
 #endif
@@ -358,19 +460,24 @@ void TryPieces(Field_t * Pre)
                 Field.Placed[pn] = 1;
 
 
-                if (Field.Pos[BottomFreeRow][BottomFreeCol] == 0){
+                if (Field.Pos[Free] == 0){
                     // The bottom left free sqare was NOT occupied by the piece.
+                    STATS_COUNT(Redundant);
                     goto redundant_pos;
                 }
 
 
                 GlobalPlaces += 1;
+                STATS_FIT();
 
                 if (NumPlaced+1 >= 11){
                     GlobalAlmost += 1;
                 }
 
-                if (GlobalSolutions > 5000) return;
+                if (GlobalSolutions > 5000){
+                    STATS_LEAVE();
+                    return;
+                }
                 if (NumPlaced+1 >= 12){
                     #ifndef TEST_MODULE
 						printf("\nSol %4d Almost %8d Placings %8d\n",
@@ -392,19 +499,18 @@ void TryPieces(Field_t * Pre)
             }
         }
     }
+    STATS_LEAVE();
 }
 
 
 //--------------------------------------------------------------------------
-// Run the pentomino solver for benchmarking purposes.
+// Generate the unique variants of each piece.  LimitFirst keeps the first
+// piece to one way round, so rotated and mirrored solutions aren't found.
 //--------------------------------------------------------------------------
-int PentominoBenchmark(void)
+static void MakeVariants(int LimitFirst)
 {
     int a,b,c;
     Piece_t Temp1, Temp2;
-	GlobalPlaces = 0;
-	GlobalAlmost = 0;
-	GlobalSolutions = 0;
 
     /*
     for (a=0;a<12;a++){
@@ -467,32 +573,1032 @@ int PentominoBenchmark(void)
 
     // By limiting the variants of the diagonally symetric L piece,
     // we ensure we don't get different ways of orienting the whole puzzle.
-    NumVariants[0] = 1;
+    if (LimitFirst) NumVariants[0] = 1;
+}
+
+//--------------------------------------------------------------------------
+// Run the pentomino solver for benchmarking purposes.
+//--------------------------------------------------------------------------
+int PentominoBenchmark(void)
+{
+	GlobalPlaces = 0;
+	GlobalAlmost = 0;
+	GlobalSolutions = 0;
+
+    MakeVariants(TRUE);
 
     {
         Field_t Field;
         memset(&Field, 0, sizeof(Field_t));
 
         // Initialize the playing field.
-        for (a=0;a<12;a++){
-            Field.Pos[a][0] = 0xff;
-            Field.Pos[a][7] = 0xff;
-        }
-        for (a=0;a<8;a++){
-            Field.Pos[0][a] = 0xff;
-            Field.Pos[11][a] = 0xff;
-        }
+        MakeGrid(Field.Pos);
 
         //ShowFancy(&Field);
+        STATS_RESET();
         TryPieces(&Field);
+        STATS_PRINT("2D byte grid");
+    }
+	if (GlobalSolutions != PentominoBoardSolutions()) printf("Solutins found: %d\n",GlobalSolutions);
+
+    return GlobalSolutions;
+}
+
+
+//==========================================================================
+// TryPieces without the recursion or the copying.  There is one field,
+// changed in place, and a placement is undone by XORing the piece back out.
+// Where each level is at is kept in a cursor on an explicit stack.  Same
+// checks in the same order, so it makes the same placements as TryPieces.
+// It uses the same byte grid, which has room past the top border for the
+// 4 byte reads and writes of a piece's top rows.
+//==========================================================================
+typedef struct {
+    int pn, pv, px;    // Placement being tried at this level.
+    int Row, Col;      // The bottom most, left most free square.
+}Cursor_t;
+
+//--------------------------------------------------------------------------
+// Check if a piece fits at py,px.
+//--------------------------------------------------------------------------
+static int FitsAt(BYTE * Pos, Piece_t * Piece, int py, int px)
+{
+    int S = GridStride;
+    BYTE * At = &Pos[py*S+px];
+    if (*((uint32_t *)&(Piece->Used[0][0])) & *((uint32_t *)(At    ))) return FALSE;
+    if (*((uint32_t *)&(Piece->Used[1][0])) & *((uint32_t *)(At+  S))) return FALSE;
+    if (*((uint32_t *)&(Piece->Used[2][0])) & *((uint32_t *)(At+2*S))) return FALSE;
+    if (*((WORD *)&(Piece->Used[3][0])) & *((WORD *)(At+3*S))) return FALSE;
+    if (Piece->Used[0][4] & At[4]) return FALSE;
+    if (Piece->Used[4][0] & At[4*S]) return FALSE;
+    return TRUE;
+}
+
+//--------------------------------------------------------------------------
+// Place a piece at py,px, or take it out again.
+//--------------------------------------------------------------------------
+static void TogglePiece(BYTE * Pos, Piece_t * Piece, int py, int px)
+{
+    int S = GridStride;
+    BYTE * At = &Pos[py*S+px];
+    *((uint32_t *)(At    )) ^= *((uint32_t *)&(Piece->Used[0][0]));
+                  At[4]     ^= Piece->Used[0][4];
+    *((uint32_t *)(At+  S)) ^= *((uint32_t *)&(Piece->Used[1][0]));
+    *((uint32_t *)(At+2*S)) ^= *((uint32_t *)&(Piece->Used[2][0]));
+    *((uint32_t *)(At+3*S)) ^= *((uint32_t *)&(Piece->Used[3][0]));
+                  At[4*S]   ^= Piece->Used[4][0];
+}
+
+//--------------------------------------------------------------------------
+// Point a cursor at the first free square, at or above row Row.
+//--------------------------------------------------------------------------
+static void StartCursor(BYTE * Pos, Cursor_t * c, int Row)
+{
+    int Free;
+    c->pn = c->pv = 0;
+    c->px = 1;
+    for (Free=Row*GridStride;Free<GRID_SIZE;Free++){
+        if (Pos[Free] == 0) break;
+    }
+    c->Row = Free / GridStride;
+    c->Col = Free % GridStride;
+}
+
+//--------------------------------------------------------------------------
+// The search loop.
+//--------------------------------------------------------------------------
+static void TryPiecesLoop(BYTE * Pos)
+{
+    Cursor_t Stack[12];
+    Cursor_t * c;
+    int Depth = 0, Placed = 0;
+
+    StartCursor(Pos, &Stack[0], 1);
+
+    for (;;){
+        c = &Stack[Depth];
+
+        // Next placement at this level that fits and covers the free square.
+        for (;c->pn<12;c->pn++,c->pv=0){
+            if (Placed & (1<<c->pn)) continue;
+            for (;c->pv<NumVariants[c->pn];c->pv++,c->px=1){
+                Piece_t * Piece = &Variants[c->pn][c->pv];
+                for (;c->px<=c->Col;c->px++){
+                    if (!FitsAt(Pos, Piece, c->Row, c->px)) continue;
+                    if (Piece->Used[0][c->Col-c->px] == 0) continue;
+                    goto found;
+                }
+            }
+        }
+
+        // Nothing left here.  Back up a level and take its piece out.
+        if (--Depth < 0) break;
+        c = &Stack[Depth];
+        TogglePiece(Pos, &Variants[c->pn][c->pv], c->Row, c->px);
+        Placed ^= 1 << c->pn;
+        c->px++;
+        continue;
+
+        found:
+        GlobalPlaces += 1;
+        if (Depth+1 >= 11) GlobalAlmost += 1;
+        if (Depth+1 >= 12){
+            GlobalSolutions += 1;
+            c->px++;
+            continue;
+        }
+
+        TogglePiece(Pos, &Variants[c->pn][c->pv], c->Row, c->px);
+        Placed |= 1 << c->pn;
+        Depth++;
+        StartCursor(Pos, &Stack[Depth], c->Row);
+    }
+}
+
+//--------------------------------------------------------------------------
+// Run the copy free solver.
+//--------------------------------------------------------------------------
+int PentominoIterative(void)
+{
+    BYTE Pos[GRID_SIZE];
+	GlobalPlaces = 0;
+	GlobalAlmost = 0;
+	GlobalSolutions = 0;
+
+    MakeVariants(TRUE);
+    MakeGrid(Pos);
+
+    TryPiecesLoop(Pos);
+	if (GlobalSolutions != PentominoBoardSolutions()) printf("Solutins found: %d\n",GlobalSolutions);
+
+    return GlobalSolutions;
+}
+
+
+//==========================================================================
+// Bitboard version of the same search.  The field is 128 bits, one for each
+// square of the byte grid above (bit row*GridStride+col), with the border
+// squares set.  Piece variants are masks in the same layout, so testing a
+// piece is an AND and placing it an OR, on two 64 bit words.
+//==========================================================================
+typedef unsigned long long u64;
+typedef struct {
+    u64 Lo, Hi;
+}Bits128_t;
+
+thread_local u64 VariantBits[12][8];   // Variant masks, which all fit in 5 rows.
+thread_local int VariantFirst[12][8];  // Lowest square of each variant.
+
+//--------------------------------------------------------------------------
+// Index of the lowest set bit.  x must not be zero.
+//--------------------------------------------------------------------------
+static int LowestBit(u64 x)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#elif defined(_M_X64)
+    unsigned long n;
+    _BitScanForward64(&n, x);
+    return (int)n;
+#else
+    int n = 0;
+    while (!(x & 1)){
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+//--------------------------------------------------------------------------
+// Variant mask moved up to square Pos on the 128 bit field.
+//--------------------------------------------------------------------------
+static Bits128_t PlaceBits(u64 Mask, int Pos)
+{
+    Bits128_t b;
+    if (Pos >= 64){
+        b.Lo = 0;
+        b.Hi = Mask << (Pos-64);
+    }else{
+        b.Lo = Mask << Pos;
+        b.Hi = Pos ? Mask >> (64-Pos) : 0;
+    }
+    return b;
+}
+
+//--------------------------------------------------------------------------
+// The recursive search, on bitboards.  Like TryPieces, the next piece must
+// cover the bottom most, left most free square.  So its lowest square goes
+// there, and the borders catch anything that would stick out of the field.
+//--------------------------------------------------------------------------
+static void TryPiecesBits(Bits128_t Field, int Placed, int NumPlaced)
+{
+    int pn, pv, Free;
+
+    Free = ~Field.Lo ? LowestBit(~Field.Lo) : 64+LowestBit(~Field.Hi);
+
+    for (pn=0;pn<12;pn++){
+        if (Placed & (1<<pn)) continue;
+
+        for (pv=0;pv<NumVariants[pn];pv++){
+            Bits128_t Piece, Next;
+            Piece = PlaceBits(VariantBits[pn][pv], Free-VariantFirst[pn][pv]);
+            if ((Piece.Lo & Field.Lo) | (Piece.Hi & Field.Hi)) continue;
+
+            GlobalPlaces += 1;
+            if (NumPlaced+1 >= 11) GlobalAlmost += 1;
+            if (NumPlaced+1 >= 12){
+                GlobalSolutions += 1;
+                continue;
+            }
+
+            Next.Lo = Field.Lo | Piece.Lo;
+            Next.Hi = Field.Hi | Piece.Hi;
+            TryPiecesBits(Next, Placed | (1<<pn), NumPlaced+1);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+// Make the variant masks, and return the empty field as a bitboard.
+//--------------------------------------------------------------------------
+static Bits128_t MakeBitVariants(void)
+{
+    Bits128_t Field;
+    BYTE Grid[GRID_SIZE];
+    int pn, pv, row, col, Pos;
+
+    MakeVariants(TRUE);
+    MakeGrid(Grid);
+
+    for (pn=0;pn<12;pn++){
+        for (pv=0;pv<NumVariants[pn];pv++){
+            u64 Mask = 0;
+            for (row=0;row<5;row++){
+                for (col=0;col<5;col++){
+                    if (Variants[pn][pv].Used[row][col]) Mask |= 1ULL << (row*GridStride+col);
+                }
+            }
+            VariantBits[pn][pv] = Mask;
+            VariantFirst[pn][pv] = LowestBit(Mask);
+        }
+    }
+
+    // Border squares, and everything past the top border, are taken.
+    Field.Lo = Field.Hi = 0;
+    for (Pos=0;Pos<GRID_SIZE;Pos++){
+        if (!Grid[Pos]) continue;
+        if (Pos < 64){
+            Field.Lo |= 1ULL << Pos;
+        }else{
+            Field.Hi |= 1ULL << (Pos-64);
+        }
+    }
+    return Field;
+}
+
+//--------------------------------------------------------------------------
+// Run the bitboard solver.  Finds the same solutions as PentominoBenchmark.
+//--------------------------------------------------------------------------
+int PentominoBitboard(void)
+{
+    Bits128_t Field;
+    GlobalPlaces = 0;
+    GlobalAlmost = 0;
+    GlobalSolutions = 0;
+
+    Field = MakeBitVariants();
+    TryPiecesBits(Field, 0, 0);
+	if (GlobalSolutions != PentominoBoardSolutions()) printf("Solutins found: %d\n",GlobalSolutions);
+
+    return GlobalSolutions;
+}
+
+
+//==========================================================================
+// Bitboards again, but with every placement worked out ahead of time.  For
+// each square and piece there is a list of the placements that have their
+// lowest square there and fit in the empty field.  The search only goes
+// through the lists for the first free square, so there are no shifts, and
+// nothing to reject for running into the border.
+//
+// Squares are numbered row*Width+col, with no borders.
+//==========================================================================
+#define MAX_PLACEMENTS 4096   // 64 squares times 60 variants at most.
+thread_local Bits128_t PlaceMasks[MAX_PLACEMENTS];
+thread_local short PlaceStart[128][12+1]; // Lists for square, piece run from
+                                          // PlaceStart[sq][pn] to PlaceStart[sq][pn+1]
+thread_local int BoardWidth;
+thread_local u64 NotLeftCol, NotRightCol; // Squares not in the first or last column.
+
+static void SetBit(Bits128_t * b, int Pos)
+{
+    if (Pos < 64){
+        b->Lo |= 1ULL << Pos;
+    }else{
+        b->Hi |= 1ULL << (Pos-64);
+    }
+}
+
+//--------------------------------------------------------------------------
+// Build the placement lists for the current board, and return the empty
+// field, which has the hole and everything past the last row taken.
+//--------------------------------------------------------------------------
+static Bits128_t MakePlacements(int LimitFirst)
+{
+    const Board_t * Board = &Boards[BoardNum];
+    Bits128_t Field;
+    int Pos, pn, pv, n = 0;
+
+    MakeVariants(LimitFirst);
+
+    BoardWidth = Board->Width;
+    NotLeftCol = NotRightCol = ~0ULL;
+    Field.Lo = Field.Hi = 0;
+    for (Pos=0;Pos<128;Pos++){
+        int row = Pos / Board->Width;
+        int col = Pos % Board->Width;
+        if (Pos < 64 && col == 0) NotLeftCol &= ~(1ULL << Pos);
+        if (Pos < 64 && col == Board->Width-1) NotRightCol &= ~(1ULL << Pos);
+        if (row >= Board->Height
+                || (col >= Board->HoleX && col < Board->HoleX+Board->HoleW
+                 && row >= Board->HoleY && row < Board->HoleY+Board->HoleH)){
+            SetBit(&Field, Pos);
+        }
+    }
+
+    for (Pos=0;Pos<128;Pos++){
+        int row = Pos / Board->Width;
+        int col = Pos % Board->Width;
+        for (pn=0;pn<12;pn++){
+            PlaceStart[Pos][pn] = (short)n;
+            for (pv=0;pv<NumVariants[pn];pv++){
+                Piece_t * Var = &Variants[pn][pv];
+                Bits128_t Piece;
+                int r, c, First = 0, Fits = TRUE;
+
+                // Lowest square of the variant goes on Pos.
+                while (!Var->Used[0][First]) First++;
+
+                Piece.Lo = Piece.Hi = 0;
+                for (r=0;r<5;r++){
+                    for (c=0;c<5;c++){
+                        int x = col+c-First, y = row+r;
+                        if (!Var->Used[r][c]) continue;
+                        if (x < 0 || x >= Board->Width || y >= Board->Height){
+                            Fits = FALSE;
+                        }else{
+                            SetBit(&Piece, y*Board->Width+x);
+                        }
+                    }
+                }
+                if (!Fits || (Piece.Lo & Field.Lo) | (Piece.Hi & Field.Hi)) continue;
+                if (n >= MAX_PLACEMENTS){
+                    printf("More than %d placements on %s\n", MAX_PLACEMENTS, Board->Name);
+                    exit(-1);
+                }
+                PlaceMasks[n++] = Piece;
+            }
+        }
+        PlaceStart[Pos][12] = (short)n;
+    }
+    return Field;
+}
+
+//--------------------------------------------------------------------------
+// The recursive search, going through the placement lists.
+//--------------------------------------------------------------------------
+static void TryPiecesTable(Bits128_t Field, int Placed, int NumPlaced)
+{
+    int pn, p, Free;
+
+    Free = ~Field.Lo ? LowestBit(~Field.Lo) : 64+LowestBit(~Field.Hi);
+    STATS_ENTER(NumPlaced);
+
+    for (pn=0;pn<12;pn++){
+        int End;
+        if (Placed & (1<<pn)) continue;
+
+        End = PlaceStart[Free][pn+1];
+        for (p=PlaceStart[Free][pn];p<End;p++){
+            Bits128_t Piece, Next;
+            Piece = PlaceMasks[p];
+            STATS_COUNT(Tries);
+            if ((Piece.Lo & Field.Lo) | (Piece.Hi & Field.Hi)) continue;
+
+            GlobalPlaces += 1;
+            STATS_FIT();
+            if (NumPlaced+1 >= 11) GlobalAlmost += 1;
+            if (NumPlaced+1 >= 12){
+                GlobalSolutions += 1;
+                continue;
+            }
+
+            Next.Lo = Field.Lo | Piece.Lo;
+            Next.Hi = Field.Hi | Piece.Hi;
+            TryPiecesTable(Next, Placed | (1<<pn), NumPlaced+1);
+        }
+    }
+    STATS_LEAVE();
+}
+
+//--------------------------------------------------------------------------
+// Run the placement table solver.
+//--------------------------------------------------------------------------
+int PentominoTables(void)
+{
+    Bits128_t Field;
+    GlobalPlaces = 0;
+    GlobalAlmost = 0;
+    GlobalSolutions = 0;
+
+    Field = MakePlacements(TRUE);
+    STATS_RESET();
+    TryPiecesTable(Field, 0, 0);
+    STATS_PRINT("2D placement tables");
+	if (GlobalSolutions != PentominoBoardSolutions()) printf("Solutins found: %d\n",GlobalSolutions);
+
+    return GlobalSolutions;
+}
+
+
+//==========================================================================
+// Optional pruning for the placement table search.  A placement that walls
+// off a free region whose size isn't a multiple of 5 can't lead to a
+// solution.  Only regions next to the piece just placed can have changed,
+// so only those get flood filled.  All the boards fit in the low 64 bits.
+//==========================================================================
+thread_local int GlobalPruned = 0;
+
+static int BitCount(u64 x)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    int n = 0;
+    while (x){
+        x &= x-1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+//--------------------------------------------------------------------------
+// Squares next to the squares in b.
+//--------------------------------------------------------------------------
+static u64 Neighbours(u64 b)
+{
+    return ((b << 1) & NotLeftCol) | ((b >> 1) & NotRightCol)
+          | (b << BoardWidth) | (b >> BoardWidth);
+}
+
+//--------------------------------------------------------------------------
+// Check if placing Piece cut off a free region that can't be filled.
+//--------------------------------------------------------------------------
+static int DeadRegion(u64 Free, u64 Piece)
+{
+    u64 Seeds = Neighbours(Piece) & Free;
+
+    while (Seeds){
+        u64 Region = Seeds & (~Seeds+1);
+        for (;;){
+            u64 Grown = (Region | Neighbours(Region)) & Free;
+            if (Grown == Region) break;
+            Region = Grown;
+        }
+        if (BitCount(Region) % 5) return TRUE;
+        Seeds &= ~Region;
+    }
+    return FALSE;
+}
+
+//--------------------------------------------------------------------------
+// TryPiecesTable, with the pruning.
+//--------------------------------------------------------------------------
+static void TryPiecesPruned(Bits128_t Field, int Placed, int NumPlaced)
+{
+    int pn, p, Free;
+
+    Free = ~Field.Lo ? LowestBit(~Field.Lo) : 64+LowestBit(~Field.Hi);
+
+    for (pn=0;pn<12;pn++){
+        int End;
+        if (Placed & (1<<pn)) continue;
+
+        End = PlaceStart[Free][pn+1];
+        for (p=PlaceStart[Free][pn];p<End;p++){
+            Bits128_t Piece, Next;
+            Piece = PlaceMasks[p];
+            if ((Piece.Lo & Field.Lo) | (Piece.Hi & Field.Hi)) continue;
+
+            if (NumPlaced+1 >= 12){
+                GlobalPlaces += 1;
+                GlobalSolutions += 1;
+                continue;
+            }
+
+            Next.Lo = Field.Lo | Piece.Lo;
+            Next.Hi = Field.Hi | Piece.Hi;
+            if (DeadRegion(~Next.Lo, Piece.Lo)){
+                GlobalPruned += 1;
+                continue;
+            }
+
+            GlobalPlaces += 1;
+            if (NumPlaced+1 >= 11) GlobalAlmost += 1;
+            TryPiecesPruned(Next, Placed | (1<<pn), NumPlaced+1);
+        }
     }
-	if (GlobalSolutions != 2339) printf("Solutins found: %d\n",GlobalSolutions);
+}
+
+//--------------------------------------------------------------------------
+// Run the placement table solver with pruning.
+//--------------------------------------------------------------------------
+int PentominoPruned(void)
+{
+    Bits128_t Field;
+    GlobalPlaces = 0;
+    GlobalAlmost = 0;
+    GlobalSolutions = 0;
+    GlobalPruned = 0;
+
+    Field = MakePlacements(TRUE);
+    TryPiecesPruned(Field, 0, 0);
+	if (GlobalSolutions != PentominoBoardSolutions()) printf("Solutins found: %d\n",GlobalSolutions);
 
     return GlobalSolutions;
 }
 
 
+//==========================================================================
+// Finding every solution, and writing out the ones that are distinct.
+// All the variants of all the pieces are used, so every rotation and mirror
+// image of each solution turns up.  A solution is only written if it is
+// the smallest of those, comparing piece numbers square by square, which
+// keeps one of each without having to remember what was written.
+//
+// Solutions are written as 4 bits per square, in square order, two squares
+// to a byte (first square in the low nibble).  30 bytes for 60 squares.
+//==========================================================================
+#define MAX_SYMMETRIES 8
+#define ENUM_BUFFER_SIZE 65536
+
+typedef struct {
+    FILE * fp;
+    int Used;
+    int Bytes;
+    double Seconds;    // Time spent in fwrite.
+    unsigned char Buf[ENUM_BUFFER_SIZE];
+}SolutionWriter_t;
+
+static thread_local SolutionWriter_t * Writer;
+static thread_local int Square[128];      // Square number of each bit, or -1
+static thread_local int NumSquares;
+static thread_local BYTE SymPerm[MAX_SYMMETRIES][128]; // Where each square goes
+static thread_local int NumSymmetries;
+static thread_local int EnumPiece[12], EnumPlace[12];
+thread_local int GlobalDistinct = 0;
+
+//--------------------------------------------------------------------------
+// Number the squares, and work out which of the rotations and mirror images
+// of the board map it onto itself.
+//--------------------------------------------------------------------------
+static void MakeSymmetries(Bits128_t Field)
+{
+    const Board_t * Board = &Boards[BoardNum];
+    int W = Board->Width, H = Board->Height;
+    int b, t;
+
+    NumSquares = 0;
+    for (b=0;b<128;b++){
+        u64 Word = b < 64 ? Field.Lo : Field.Hi;
+        Square[b] = (Word >> (b & 63)) & 1 ? -1 : NumSquares++;
+    }
+
+    NumSymmetries = 0;
+    for (t=0;t<8;t++){
+        int Ok = TRUE;
+        if (t >= 4 && W != H) break; // Only a square can be turned a quarter turn.
+        for (b=0;b<W*H && Ok;b++){
+            int x = b % W, y = b / W, nx, ny;
+            if (Square[b] < 0) continue;
+            if (t & 1) x = W-1-x;
+            if (t & 2) y = H-1-y;
+            nx = x; ny = y;
+            if (t & 4){
+                nx = y;
+                ny = x;
+            }
+            if (Square[ny*W+nx] < 0){
+                Ok = FALSE;
+            }else{
+                SymPerm[NumSymmetries][Square[b]] = (BYTE)Square[ny*W+nx];
+            }
+        }
+        if (Ok) NumSymmetries++;
+    }
+}
+
+//--------------------------------------------------------------------------
+// Buffered output of solution records.
+//--------------------------------------------------------------------------
+static void FlushSolutions(void)
+{
+    double start = GetTimeSec();
+    if (Writer->fp && Writer->Used) fwrite(Writer->Buf, 1, Writer->Used, Writer->fp);
+    Writer->Seconds += GetTimeSec()-start;
+    Writer->Used = 0;
+}
+
+static void WriteSolution(BYTE * Grid)
+{
+    int a, Size = (NumSquares+1)/2;
+    unsigned char * Rec;
+
+    if (Writer->Used + Size > ENUM_BUFFER_SIZE) FlushSolutions();
+    Rec = Writer->Buf + Writer->Used;
+    for (a=0;a<Size;a++){
+        BYTE Hi = 2*a+1 < NumSquares ? Grid[2*a+1] : 0;
+        Rec[a] = (unsigned char)(Grid[2*a] | (Hi << 4));
+    }
+    Writer->Used += Size;
+    Writer->Bytes += Size;
+}
+
+//--------------------------------------------------------------------------
+// Write the solution out if no rotation or mirror image of it is smaller.
+//--------------------------------------------------------------------------
+static void SolutionFound(void)
+{
+    BYTE Grid[128], Turned[128];
+    int d, b, t;
+
+    for (d=0;d<12;d++){
+        Bits128_t Mask = PlaceMasks[EnumPlace[d]];
+        for (b=0;b<128;b++){
+            u64 Word = b < 64 ? Mask.Lo : Mask.Hi;
+            if ((Word >> (b & 63)) & 1) Grid[Square[b]] = (BYTE)EnumPiece[d];
+        }
+    }
+
+    for (t=1;t<NumSymmetries;t++){
+        for (b=0;b<NumSquares;b++) Turned[SymPerm[t][b]] = Grid[b];
+        if (memcmp(Turned, Grid, NumSquares) < 0) return;
+    }
+    GlobalDistinct += 1;
+    WriteSolution(Grid);
+}
+
+//--------------------------------------------------------------------------
+// TryPiecesTable, keeping track of what went where.
+//--------------------------------------------------------------------------
+static void TryPiecesEnum(Bits128_t Field, int Placed, int NumPlaced)
+{
+    int pn, p, Free;
+
+    Free = ~Field.Lo ? LowestBit(~Field.Lo) : 64+LowestBit(~Field.Hi);
+
+    for (pn=0;pn<12;pn++){
+        int End;
+        if (Placed & (1<<pn)) continue;
+
+        End = PlaceStart[Free][pn+1];
+        for (p=PlaceStart[Free][pn];p<End;p++){
+            Bits128_t Piece, Next;
+            Piece = PlaceMasks[p];
+            if ((Piece.Lo & Field.Lo) | (Piece.Hi & Field.Hi)) continue;
+
+            GlobalPlaces += 1;
+            EnumPiece[NumPlaced] = pn;
+            EnumPlace[NumPlaced] = p;
+            if (NumPlaced+1 >= 12){
+                GlobalSolutions += 1;
+                SolutionFound();
+                continue;
+            }
+
+            Next.Lo = Field.Lo | Piece.Lo;
+            Next.Hi = Field.Hi | Piece.Hi;
+            TryPiecesEnum(Next, Placed | (1<<pn), NumPlaced+1);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+// Find all solutions on the current board and write the distinct ones to
+// a file (if FileName isn't NULL).  Returns the number of distinct ones.
+//--------------------------------------------------------------------------
+int PentominoEnumerate(const char * FileName)
+{
+    Bits128_t Field;
+    GlobalPlaces = 0;
+    GlobalSolutions = 0;
+    GlobalDistinct = 0;
+
+    if (!Writer){
+        Writer = (SolutionWriter_t *)malloc(sizeof(SolutionWriter_t));
+        if (!Writer){
+            printf("Failed to allocate solution buffer\n");
+            exit(-1);
+        }
+    }
+    Writer->fp = NULL;
+    if (FileName){
+        Writer->fp = fopen(FileName, "wb");
+        if (!Writer->fp) printf("Can't write %s\n", FileName);
+    }
+    Writer->Used = Writer->Bytes = 0;
+    Writer->Seconds = 0;
+
+    Field = MakePlacements(FALSE);
+    MakeSymmetries(Field);
+    TryPiecesEnum(Field, 0, 0);
+
+    FlushSolutions();
+    if (Writer->fp) fclose(Writer->fp);
+
+    if (GlobalDistinct != Boards[BoardNum].Distinct){
+        printf("Distinct solutions found: %d\n", GlobalDistinct);
+    }
+    return GlobalDistinct;
+}
+
+//--------------------------------------------------------------------------
+// Splitting the search into tasks, for the parallel solver in pentopar.c.
+// Each thread must call PentominoTaskSetup before running tasks, as the
+// placement lists are per thread.
+//--------------------------------------------------------------------------
+void PentominoTaskSetup(void)
+{
+    MakePlacements(TRUE);
+}
+
+static int SplitTasks(Bits128_t Field, int Placed, int NumPlaced, int Depth,
+                      PentoTask_t * Tasks, int NumTasks, int MaxTasks)
+{
+    int pn, p, Free;
+
+    if (NumPlaced >= Depth){
+        if (NumTasks < MaxTasks){
+            Tasks[NumTasks].Lo = Field.Lo;
+            Tasks[NumTasks].Hi = Field.Hi;
+            Tasks[NumTasks].Placed = Placed;
+            Tasks[NumTasks].NumPlaced = NumPlaced;
+            Tasks[NumTasks].Solutions = 0;
+            Tasks[NumTasks].Places = 0;
+        }
+        return NumTasks+1;
+    }
+
+    Free = ~Field.Lo ? LowestBit(~Field.Lo) : 64+LowestBit(~Field.Hi);
+    for (pn=0;pn<12;pn++){
+        if (Placed & (1<<pn)) continue;
+        for (p=PlaceStart[Free][pn];p<PlaceStart[Free][pn+1];p++){
+            Bits128_t Next;
+            if ((PlaceMasks[p].Lo & Field.Lo) | (PlaceMasks[p].Hi & Field.Hi)) continue;
+            Next.Lo = Field.Lo | PlaceMasks[p].Lo;
+            Next.Hi = Field.Hi | PlaceMasks[p].Hi;
+            NumTasks = SplitTasks(Next, Placed | (1<<pn), NumPlaced+1, Depth, Tasks, NumTasks, MaxTasks);
+        }
+    }
+    return NumTasks;
+}
+
+//--------------------------------------------------------------------------
+// Make a task for each way of placing the first Depth pieces.  Returns the
+// number of tasks, which may be more than MaxTasks if they didn't all fit.
+//--------------------------------------------------------------------------
+int PentominoSplit(PentoTask_t * Tasks, int MaxTasks, int Depth)
+{
+    return SplitTasks(MakePlacements(TRUE), 0, 0, Depth, Tasks, 0, MaxTasks);
+}
+
+//--------------------------------------------------------------------------
+// Search the rest of the tree below a task.
+//--------------------------------------------------------------------------
+void PentominoRunTask(PentoTask_t * Task)
+{
+    Bits128_t Field;
+    GlobalPlaces = 0;
+    GlobalAlmost = 0;
+    GlobalSolutions = 0;
+
+    Field.Lo = Task->Lo;
+    Field.Hi = Task->Hi;
+    TryPiecesTable(Field, Task->Placed, Task->NumPlaced);
+
+    Task->Solutions = GlobalSolutions;
+    Task->Places = GlobalPlaces;
+}
+
+//--------------------------------------------------------------------------
+// Every placement that fits in the empty field, as a piece number and the
+// squares it covers, for the exact cover solver in pentodlx.c.  Squares
+// are numbered from 0 in the order the search fills them.
+//--------------------------------------------------------------------------
+int PentominoRows(PentoRow_t * Rows, int MaxRows)
+{
+    Bits128_t Field;
+    int Square[128];
+    int Pos, pn, p, n, b;
+
+    Field = MakePlacements(TRUE);
+
+    n = 0;
+    for (b=0;b<128;b++){
+        u64 Word = b < 64 ? Field.Lo : Field.Hi;
+        Square[b] = (Word >> (b & 63)) & 1 ? -1 : n++;
+    }
+
+    n = 0;
+    for (Pos=0;Pos<128;Pos++){
+        for (pn=0;pn<12;pn++){
+            for (p=PlaceStart[Pos][pn];p<PlaceStart[Pos][pn+1];p++){
+                int Covered = 0;
+                if (n >= MaxRows) return -1;
+                for (b=0;b<128;b++){
+                    u64 Word = b < 64 ? PlaceMasks[p].Lo : PlaceMasks[p].Hi;
+                    if ((Word >> (b & 63)) & 1) Rows[n].Squares[Covered++] = (unsigned char)Square[b];
+                }
+                Rows[n].Piece = pn;
+                n++;
+            }
+        }
+    }
+    return n;
+}
+
+//--------------------------------------------------------------------------
+// Size of board n, whether a square is part of it, and how many solutions
+// it has, for solvers that lay out their own field, like the ones in
+// pentospec.c.  They take the board number rather than using the current
+// board, so tests can go through the boards without changing it for the
+// other threads.
+//--------------------------------------------------------------------------
+void PentominoBoardSize(int n, int * Width, int * Height)
+{
+    *Width = Boards[n].Width;
+    *Height = Boards[n].Height;
+}
+
+int PentominoBoardSquare(int n, int x, int y)
+{
+    const Board_t * Board = &Boards[n];
+    if (x < 0 || x >= Board->Width || y < 0 || y >= Board->Height) return FALSE;
+    return !(x >= Board->HoleX && x < Board->HoleX+Board->HoleW
+          && y >= Board->HoleY && y < Board->HoleY+Board->HoleH);
+}
+
+//--------------------------------------------------------------------------
+// The shapes of the pieces, each variant as the rows and columns of its
+// other four squares relative to its lowest one.  The L piece is kept to
+// one way round.
+//--------------------------------------------------------------------------
+void PentominoShapes(PentoShape_t * Shapes)
+{
+    int pn, pv, r, c;
+
+    MakeVariants(TRUE);
+    for (pn=0;pn<12;pn++){
+        Shapes[pn].NumVariants = NumVariants[pn];
+        for (pv=0;pv<NumVariants[pn];pv++){
+            Piece_t * Var = &Variants[pn][pv];
+            int First = 0, k = 0;
+            while (!Var->Used[0][First]) First++;
+            for (r=0;r<5;r++){
+                for (c=0;c<5;c++){
+                    if (!Var->Used[r][c] || (r == 0 && c == First)) continue;
+                    Shapes[pn].Row[pv][k] = (signed char)r;
+                    Shapes[pn].Col[pv][k] = (signed char)(c-First);
+                    k++;
+                }
+            }
+        }
+    }
+}
+
+#ifdef TEST_MODULE
+//--------------------------------------------------------------------------
+// Time one of the solvers for perftest.  Returns millions of placements
+// per second, or -1 if it got the wrong number of solutions.
+//--------------------------------------------------------------------------
+static double PlacementRate(int (*Solver)(void), int Expected)
+{
+    double start;
+    int Solutions;
+
+    start = GetTimeSec();
+    Solutions = Solver();
+    start = GetTimeSec()-start;
+
+    if (Solutions != Expected) return -1;
+    return GlobalPlaces / start / 1e6;
+}
+
+double PentominoBytesTest(void)
+{
+    return PlacementRate(PentominoBenchmark, PentominoBoardSolutions());
+}
+
+double PentominoIterativeTest(void)
+{
+    return PlacementRate(PentominoIterative, PentominoBoardSolutions());
+}
+
+double PentominoBitsTest(void)
+{
+    return PlacementRate(PentominoBitboard, PentominoBoardSolutions());
+}
+
+// Runs of the enumeration test so far, so each one writes a file of its
+// own, as the tests may be running on more than one thread at once.
+#ifdef _MSC_VER
+    static volatile long EnumRuns;
+#else
+    static volatile int EnumRuns;
+#endif
+
+//--------------------------------------------------------------------------
+// Enumerate the solutions to a file, which is removed again afterwards.
+// Returns millions of placements per second, including the time to write
+// the file.
+//--------------------------------------------------------------------------
+double PentominoEnumTest(void)
+{
+    double start;
+    int Distinct;
+    char FileName[30];
+
+#ifdef _MSC_VER
+    sprintf(FileName, "pentominos%d.bin", (int)InterlockedIncrement(&EnumRuns));
+#else
+    sprintf(FileName, "pentominos%d.bin", __sync_add_and_fetch(&EnumRuns, 1));
+#endif
+
+    start = GetTimeSec();
+    Distinct = PentominoEnumerate(FileName);
+    start = GetTimeSec()-start;
+    remove(FileName);
+
+    printf("Enumerated %s board: %d solutions, %d distinct, %d bytes written in %.1f ms\n",
+            PentominoBoardName(PentominoBoardNum()), GlobalSolutions, Distinct,
+            Writer->Bytes, Writer->Seconds*1000);
+
+    if (Distinct != PentominoBoardDistinct()) return -1;
+    return GlobalPlaces / start / 1e6;
+}
+
+double PentominoTablesTest(void)
+{
+    return PlacementRate(PentominoTables, PentominoBoardSolutions());
+}
+
+//--------------------------------------------------------------------------
+// Compare the placement table search with and without pruning.  Returns
+// how many times faster pruning makes it.
+//--------------------------------------------------------------------------
+double PentominoPruneTest(void)
+{
+    double Times[2];
+    int Solutions[2], Places[2];
+    int a;
+
+    for (a=0;a<2;a++){
+        Times[a] = GetTimeSec();
+        Solutions[a] = a ? PentominoPruned() : PentominoTables();
+        Times[a] = GetTimeSec()-Times[a];
+        Places[a] = GlobalPlaces;
+    }
+
+    printf("Dead region pruning, %s board\n", PentominoBoardName(PentominoBoardNum()));
+    printf("  without: %10d placements  %7.3f s\n", Places[0], Times[0]);
+    printf("  with:    %10d placements  %7.3f s  (%d pruned)\n", Places[1], Times[1], GlobalPruned);
+
+    if (Solutions[0] != PentominoBoardSolutions() || Solutions[1] != Solutions[0]) return -1;
+    return Times[0] / Times[1];
+}
+#endif
+
+
 #ifndef TEST_MODULE
+//--------------------------------------------------------------------------
+// Wall clock seconds, as in timing.c, for building this on its own.
+//--------------------------------------------------------------------------
+double GetTimeSec(void)
+{
+#if _WIN32 || _WIN64
+    LARGE_INTEGER freq_t, now_t;
+    QueryPerformanceFrequency(&freq_t);
+    QueryPerformanceCounter(&now_t);
+    return (double)now_t.QuadPart / freq_t.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
 //--------------------------------------------------------------------------
 // Mainline
 //--------------------------------------------------------------------------
@@ -507,6 +1613,16 @@ int main(void)
     printf("\nElapsed time:%d\n",(int)(end-start));
 	
 	printf("Solutins found: %d\n",NumSolutions);
+
+	time(&start);
+	NumSolutions = PentominoBitboard();
+    time(&end);
+    printf("Bitboard version: %d solutions, elapsed time:%d\n",NumSolutions,(int)(end-start));
+
+	time(&start);
+	NumSolutions = PentominoTables();
+    time(&end);
+    printf("Placement tables: %d solutions, elapsed time:%d\n",NumSolutions,(int)(end-start));
 	return 0;
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,298 @@
+//----------------------------------------------------------------------------
+// Parallel version of the 2D pentomino search.  Unlike running the benchmark
+// on several cores at once, this splits one search across the cores.
+//
+// The tree is cut after the first two pieces into a few hundred tasks.
+// Each thread starts with its own run of tasks, works from the end of it,
+// and when it runs out, steals from the start of someone else's.  Solution
+// counts stay with each task, so the total doesn't depend on which thread
+// ran what.
+//
+// The pool itself doesn't know what the tasks are, so the 3D solver uses
+// it too.  Everything about a pool run is in a Pool_t of its own, so the
+// tests running on several -a threads at once can each run a pool.
+//----------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#if _WIN32 || _WIN64
+    #define _WINDOWS 1
+#else
+    #define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _WINDOWS
+    #include <windows.h>
+#else
+    #include <unistd.h>
+    #include <pthread.h>
+    #ifdef __linux__
+        #include <sched.h>
+    #endif
+#endif
+#include "perftest.h"
+
+#define MAX_WORKERS POOL_MAX_WORKERS
+#define MAX_TASKS 4096
+#define SPLIT_DEPTH 2
+
+#ifdef _WINDOWS
+    typedef CRITICAL_SECTION Lock_t;
+    #define LockInit(l) InitializeCriticalSection(l)
+    #define LockFree(l) DeleteCriticalSection(l)
+    #define Lock(l)     EnterCriticalSection(l)
+    #define Unlock(l)   LeaveCriticalSection(l)
+#else
+    typedef pthread_mutex_t Lock_t;
+    #define LockInit(l) pthread_mutex_init(l, NULL)
+    #define LockFree(l) pthread_mutex_destroy(l)
+    #define Lock(l)     pthread_mutex_lock(l)
+    #define Unlock(l)   pthread_mutex_unlock(l)
+#endif
+
+struct Pool_s;
+
+typedef struct {
+    Lock_t Lock;
+    int Top, Bottom;   // Tasks not taken yet, Top to Bottom-1
+    int Core;
+    int Steals;
+    int Self;          // Which worker this is
+    struct Pool_s * Pool;
+}Worker_t;
+
+typedef struct Pool_s {
+    Worker_t Workers[MAX_WORKERS];
+    int NumWorkers;
+
+    // What the threads of the pool run.
+    void (*Setup)(void);
+    void (*Run)(void * Context, int Task, int Worker);
+    void (*Done)(void);
+    void * Context;
+}Pool_t;
+
+//----------------------------------------------------------------------------
+// Number of cores we can run on.
+//----------------------------------------------------------------------------
+int PoolCores(void)
+{
+#ifdef _WINDOWS
+    SYSTEM_INFO Info;
+    GetSystemInfo(&Info);
+    return Info.dwNumberOfProcessors;
+#else
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? n : 1;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Pin the calling thread to a core.  Where we can't, the OS decides.
+//----------------------------------------------------------------------------
+static void PinToCore(int core)
+{
+#ifdef _WINDOWS
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core);
+#elif defined(__linux__)
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core, &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+#else
+    (void)core;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Next task for a worker.  Its own last one, or else the first one of the
+// next worker that still has some.  Returns -1 when there are none left.
+//----------------------------------------------------------------------------
+static int NextTask(Pool_t * Pool, int Self)
+{
+    Worker_t * w = &Pool->Workers[Self];
+    int t = -1, a;
+
+    Lock(&w->Lock);
+    if (w->Bottom > w->Top) t = --w->Bottom;
+    Unlock(&w->Lock);
+    if (t >= 0) return t;
+
+    for (a=1;a<Pool->NumWorkers && t < 0;a++){
+        Worker_t * v = &Pool->Workers[(Self+a) % Pool->NumWorkers];
+        Lock(&v->Lock);
+        if (v->Bottom > v->Top) t = v->Top++;
+        Unlock(&v->Lock);
+    }
+    if (t >= 0) w->Steals += 1;
+    return t;
+}
+
+//----------------------------------------------------------------------------
+// Worker thread.
+//----------------------------------------------------------------------------
+#ifdef _WINDOWS
+static DWORD WINAPI WorkerThread(LPVOID param)
+#else
+static void * WorkerThread(void * param)
+#endif
+{
+    Worker_t * w = (Worker_t *)param;
+    Pool_t * Pool = w->Pool;
+    int t;
+
+    PinToCore(w->Core);
+    if (Pool->Setup) Pool->Setup();
+
+    while ((t = NextTask(Pool, w->Self)) >= 0){
+        Pool->Run(Pool->Context, t, w->Self);
+    }
+    if (Pool->Done) Pool->Done();
+#ifdef _WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Run all the tasks on a number of threads, one per core.  Returns the
+// total number of steals.
+//----------------------------------------------------------------------------
+static int RunPool(Pool_t * Pool, int NumThreads, int NumTasks)
+{
+#ifdef _WINDOWS
+    HANDLE threads[MAX_WORKERS];
+#else
+    pthread_t threads[MAX_WORKERS];
+#endif
+    int a, Steals = 0;
+
+    // Each thread gets an even run of tasks to start with.  The ones that
+    // split off early pieces with many ways to go on take longer, so the
+    // runs don't take equally long, which the stealing evens out.
+    Pool->NumWorkers = NumThreads;
+    for (a=0;a<NumThreads;a++){
+        Worker_t * w = &Pool->Workers[a];
+        LockInit(&w->Lock);
+        w->Top = NumTasks * a / NumThreads;
+        w->Bottom = NumTasks * (a+1) / NumThreads;
+        w->Core = a;
+        w->Steals = 0;
+        w->Self = a;
+        w->Pool = Pool;
+    }
+
+    for (a=0;a<NumThreads;a++){
+#ifdef _WINDOWS
+        threads[a] = CreateThread(NULL, 0, WorkerThread, &Pool->Workers[a], 0, NULL);
+#else
+        if (pthread_create(&threads[a], NULL, WorkerThread, &Pool->Workers[a]) != 0){
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+#endif
+    }
+
+    for (a=0;a<NumThreads;a++){
+#ifdef _WINDOWS
+        WaitForSingleObject(threads[a], INFINITE);
+        CloseHandle(threads[a]);
+#else
+        pthread_join(threads[a], NULL);
+#endif
+        LockFree(&Pool->Workers[a].Lock);
+        Steals += Pool->Workers[a].Steals;
+    }
+    return Steals;
+}
+
+//----------------------------------------------------------------------------
+// Run tasks 0 to NumTasks-1 on a pool of threads.  Each thread calls Setup
+// before its first task and Done after its last, either may be NULL.  Run
+// gets Context, for what the tasks work on.  Returns the number of tasks
+// stolen.
+//----------------------------------------------------------------------------
+int RunTaskPool(int NumThreads, int NumTasks, void (*Setup)(void),
+                void (*Run)(void * Context, int Task, int Worker), void (*Done)(void),
+                void * Context)
+{
+    Pool_t * Pool;
+    int Steals;
+
+    if (NumThreads > MAX_WORKERS) NumThreads = MAX_WORKERS;
+    Pool = (Pool_t *)malloc(sizeof(Pool_t));
+    if (!Pool){
+        printf("Failed to allocate thread pool\n");
+        exit(-1);
+    }
+    Pool->Setup = Setup;
+    Pool->Run = Run;
+    Pool->Done = Done;
+    Pool->Context = Context;
+    Steals = RunPool(Pool, NumThreads, NumTasks);
+    free(Pool);
+    return Steals;
+}
+
+static void RunPentoTask(void * Context, int Task, int Worker)
+{
+    (void)Worker;
+    PentominoRunTask((PentoTask_t *)Context + Task);
+}
+
+//----------------------------------------------------------------------------
+// Time the whole search on 1, 2, 4... threads, up to one per core.
+// Returns how many times faster it is on all cores than on one.
+//----------------------------------------------------------------------------
+double PentominoParallelTest(void)
+{
+    int Cores = PoolCores();
+    int NumTasks, Threads, a;
+    double OneThread = 0, Speedup = 0;
+    PentoTask_t * Tasks;
+
+    if (Cores > MAX_WORKERS) Cores = MAX_WORKERS;
+
+    Tasks = (PentoTask_t *)malloc(MAX_TASKS*sizeof(PentoTask_t));
+    if (!Tasks){
+        printf("Failed to allocate tasks\n");
+        exit(-1);
+    }
+    PentominoTaskSetup();
+    NumTasks = PentominoSplit(Tasks, MAX_TASKS, SPLIT_DEPTH);
+    if (NumTasks > MAX_TASKS){
+        printf("Too many tasks (%d)\n", NumTasks);
+        free(Tasks);
+        return -1;
+    }
+
+    printf("Parallel pentomino search, %s board, %d tasks, %d cores\n",
+            PentominoBoardName(PentominoBoardNum()), NumTasks, Cores);
+    printf("  threads   time (s)  speedup  steals\n");
+    for (Threads=1;;Threads*=2){
+        double start;
+        int Solutions = 0, Steals;
+
+        if (Threads > Cores) Threads = Cores;
+
+        start = GetTimeSec();
+        Steals = RunTaskPool(Threads, NumTasks, PentominoTaskSetup, RunPentoTask, NULL, Tasks);
+        start = GetTimeSec()-start;
+
+        for (a=0;a<NumTasks;a++) Solutions += Tasks[a].Solutions;
+        if (Solutions != PentominoBoardSolutions()){
+            printf("Parallel pentomino found %d solutions\n", Solutions);
+            free(Tasks);
+            return -1;
+        }
+
+        if (Threads == 1) OneThread = start;
+        Speedup = OneThread / start;
+        printf("  %5d   %9.3f  %7.2f  %6d\n", Threads, start, Speedup, Steals);
+
+        if (Threads >= Cores) break;
+    }
+    free(Tasks);
+    return Speedup;
+}
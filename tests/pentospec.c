@@ -0,0 +1,181 @@
+//----------------------------------------------------------------------------
+// The 2D pentomino search with the board size fixed at compile time, against
+// the same search with the size only known at run time.
+//
+// C has no templates, so the search is a macro, and each board gets its own
+// copy with the width, number of pieces and squares per piece as constants.
+// The compiler can then unroll the fit check and turn the row stride into
+// a shift or lea.  The generic copy is made from the same macro, with the
+// sizes read from variables, so the two differ only in what the compiler
+// knows.
+//
+// The fit checks have constant loop counts, so the compiler unrolls them.
+// The offsets of the squares still come from Shapes[], as the search picks
+// the piece and variant at run time.  Only the 2D search is done this way.
+// The 3D one reads its box and pieces from a file at run time, and its
+// placement lists already hold the offsets worked out, so it has no stride
+// arithmetic left for constants to take out.
+//
+// The field is a byte per square, with 4 columns of border to the right of
+// each row and 5 rows of border past the top, so no placement can run off
+// the board or wrap into the next row.
+//----------------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include "perftest.h"
+
+typedef unsigned char BYTE;
+
+#define BORDER_COLS 4
+#define BORDER_ROWS 5
+#define MAX_FIELD 1024
+
+typedef void (*GridSearch_t)(BYTE * Grid, int Free, int Placed, int NumPlaced);
+
+static thread_local PentoShape_t Shapes[12];
+static thread_local int SpecSolutions;
+static thread_local int SpecPlaces;
+
+// Sizes for the generic search.
+static thread_local struct {
+    int Width, Pieces, Squares;
+}Generic;
+
+//----------------------------------------------------------------------------
+// The search.  Fills the lowest free square with every piece that fits
+// there, and goes on to the next free square.
+//----------------------------------------------------------------------------
+#define DEFINE_GRID_SEARCH(Name, WIDTH, PIECES, SQUARES)                    \
+static void Name(BYTE * Grid, int Free, int Placed, int NumPlaced)          \
+{                                                                           \
+    int pn, pv, k;                                                          \
+                                                                            \
+    while (Grid[Free]) Free++;                                              \
+                                                                            \
+    for (pn=0;pn<(PIECES);pn++){                                            \
+        if (Placed & (1<<pn)) continue;                                     \
+        for (pv=0;pv<Shapes[pn].NumVariants;pv++){                          \
+            const signed char * Row = Shapes[pn].Row[pv];                   \
+            const signed char * Col = Shapes[pn].Col[pv];                   \
+            int Used = 0;                                                   \
+            for (k=0;k<(SQUARES)-1;k++){                                    \
+                Used |= Grid[Free + Row[k]*((WIDTH)+BORDER_COLS) + Col[k]]; \
+            }                                                               \
+            if (Used) continue;                                             \
+                                                                            \
+            SpecPlaces += 1;                                                \
+            if (NumPlaced+1 >= (PIECES)){                                   \
+                SpecSolutions += 1;                                         \
+                continue;                                                   \
+            }                                                               \
+            Grid[Free] = 1;                                                 \
+            for (k=0;k<(SQUARES)-1;k++){                                    \
+                Grid[Free + Row[k]*((WIDTH)+BORDER_COLS) + Col[k]] = 1;     \
+            }                                                               \
+            Name(Grid, Free+1, Placed | (1<<pn), NumPlaced+1);              \
+            Grid[Free] = 0;                                                 \
+            for (k=0;k<(SQUARES)-1;k++){                                    \
+                Grid[Free + Row[k]*((WIDTH)+BORDER_COLS) + Col[k]] = 0;     \
+            }                                                               \
+        }                                                                   \
+    }                                                                       \
+}
+
+DEFINE_GRID_SEARCH(SearchGeneric, Generic.Width, Generic.Pieces, Generic.Squares)
+DEFINE_GRID_SEARCH(Search6x10, 6, 12, 5)
+DEFINE_GRID_SEARCH(Search5x12, 5, 12, 5)
+DEFINE_GRID_SEARCH(Search4x15, 4, 12, 5)
+DEFINE_GRID_SEARCH(Search3x20, 3, 12, 5)
+DEFINE_GRID_SEARCH(Search8x8, 8, 12, 5)
+
+static const struct {
+    int Width, Height;
+    GridSearch_t Search;
+}Specialized[] = {
+    {6, 10, Search6x10},
+    {5, 12, Search5x12},
+    {4, 15, Search4x15},
+    {3, 20, Search3x20},
+    {8,  8, Search8x8},
+};
+#define NUM_SPECIALIZED (int)(sizeof(Specialized)/sizeof(Specialized[0]))
+
+//----------------------------------------------------------------------------
+// Lay out board b, with the border and any hole filled in.
+//----------------------------------------------------------------------------
+static void MakeGrid(BYTE * Grid, int b, int Width, int Height)
+{
+    int Stride = Width+BORDER_COLS;
+    int x, y;
+
+    memset(Grid, 1, (Height+BORDER_ROWS)*Stride);
+    for (y=0;y<Height;y++){
+        for (x=0;x<Width;x++){
+            if (PentominoBoardSquare(b, x, y)) Grid[y*Stride+x] = 0;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Run one of the searches on board b.  Returns seconds taken, or -1 if it
+// got the wrong number of solutions.
+//----------------------------------------------------------------------------
+static double TimeSearch(GridSearch_t Search, int b, int Width, int Height)
+{
+    BYTE Grid[MAX_FIELD];
+    double start;
+
+    MakeGrid(Grid, b, Width, Height);
+    SpecSolutions = 0;
+    SpecPlaces = 0;
+
+    start = GetTimeSec();
+    Search(Grid, 0, 0, 0);
+    start = GetTimeSec()-start;
+
+    if (SpecSolutions != PentominoKnownSolutions(b)){
+        printf("Board search found %d solutions\n", SpecSolutions);
+        return -1;
+    }
+    return start;
+}
+
+//----------------------------------------------------------------------------
+// Time the generic and the specialized search on each board that has one.
+// Returns how many times faster the specialized ones are, on average.
+//----------------------------------------------------------------------------
+double PentominoSpecTest(void)
+{
+    int b, s, NumBoards = 0;
+    double Speedups = 0;
+
+    PentominoShapes(Shapes);
+    Generic.Pieces = 12;
+    Generic.Squares = 5;
+
+    printf("Board specific searches against the generic one\n");
+    printf("  board               generic (s)  specific (s)  speedup\n");
+    for (b=0;PentominoBoardName(b);b++){
+        double GenericTime, SpecTime;
+        int Width, Height, GenericPlaces;
+
+        PentominoBoardSize(b, &Width, &Height);
+        for (s=0;s<NUM_SPECIALIZED;s++){
+            if (Specialized[s].Width == Width && Specialized[s].Height == Height) break;
+        }
+        if (s >= NUM_SPECIALIZED) continue;
+
+        Generic.Width = Width;
+        GenericTime = TimeSearch(SearchGeneric, b, Width, Height);
+        GenericPlaces = SpecPlaces;
+        SpecTime = TimeSearch(Specialized[s].Search, b, Width, Height);
+        if (GenericTime < 0 || SpecTime < 0 || SpecPlaces != GenericPlaces) return -1;
+
+        printf("  %-18s %12.3f  %12.3f  %7.2f\n", PentominoBoardName(b),
+                GenericTime, SpecTime, GenericTime / SpecTime);
+        Speedups += GenericTime / SpecTime;
+        NumBoards += 1;
+    }
+
+    return NumBoards ? Speedups / NumBoards : -1;
+}
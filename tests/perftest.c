@@ -31,6 +31,8 @@
     #include <pthread.h>
 
     #define Sleep(a) usleep((a)*1000)
+    #define TRUE 1
+    #define FALSE 0
     #ifdef __linux__
         #define GetCurrentProcessorNumber() sched_getcpu()
     #else
@@ -40,11 +42,14 @@
 #endif
 #include "perftest.h"
 
+#define MAX_TESTS 100
+
 typedef struct {
     int Affinity;
-    double Times[30];
-    int NumRuns[30];
-    int CoresRunOn[30][2];
+    double Times[MAX_TESTS];
+    double Rates[MAX_TESTS];
+    int NumRuns[MAX_TESTS];
+    int CoresRunOn[MAX_TESTS][2];
 }ThreadPassParms_t;
 
 
@@ -126,10 +131,71 @@ unsigned char * MakeDataToCrc(int size)
 const char * Methods[] = {"CRC Table  ", "CRC and_xor", "CRC if_else", "CRC if-cnt ",
                           "Pentomino  ", "3dPentomino"};
 
+// Further tests are numbered from EXTRA_TESTS_START on.  Each one returns a
+// rate in its own units (or negative if it malfunctioned), so the results
+// from several threads can be added up.
+#define EXTRA_TESTS_START 40
+typedef struct {
+    const char * Name;
+    const char * Units;
+    double (*Func)(void);
+}ExtraTest_t;
+
+ExtraTest_t ExtraTests[] = {
+    {"MemBW Read    ", "GB/s", MemBwRead},    // 40
+    {"MemBW Write   ", "GB/s", MemBwWrite},
+    {"MemBW Copy    ", "GB/s", MemBwCopy},
+    {"MemBW Triad   ", "GB/s", MemBwTriad},
+    {"MemBW Write NT", "GB/s", MemBwWriteNt},
+    {"MemBW Copy NT ", "GB/s", MemBwCopyNt},
+    {"MemBW Triad NT", "GB/s", MemBwTriadNt},
+    {"Branch period ", "period", BranchPeriodTest},  // 47
+    {"Branch static ", "branches", BranchStaticTest},
+    {"Branch history", "distance", BranchHistoryTest},
+    {"Branch indirct", "targets", BranchIndirectTest},
+    {"Instr latency ", "chains", InstrLatencyTest},  // 51
+    {"Strided int   ", "elem/cyc", StridedSumInt},    // 52
+    {"Strided float ", "elem/cyc", StridedSumFloat},
+    {"Strided double", "elem/cyc", StridedSumDouble},
+    {"Kahan cost    ", "x slower", CompensatedSumTest},  // 55
+    {"Pento bytes   ", "Mplace/s", PentominoBytesTest},  // 56
+    {"Pento bitboard", "Mplace/s", PentominoBitsTest},
+    {"Pento tables  ", "Mplace/s", PentominoTablesTest},
+    {"Pento parallel", "x faster", PentominoParallelTest},  // 59
+    {"Pento DLX     ", "x faster", PentominoDlxTest},
+    {"Pento pruning ", "x faster", PentominoPruneTest},
+    {"Pento no copy ", "Mplace/s", PentominoIterativeTest},
+    {"Pento enum    ", "Mplace/s", PentominoEnumTest},
+    {"Pento specific", "x faster", PentominoSpecTest},  // 64
+    {"3D bitboard   ", "x faster", Pentomino3dBitsTest},
+    {"3D cube lists ", "x faster", Pentomino3dListsTest},
+    {"3D count all  ", "Mplace/s", Pentomino3dCountTest},
+    {"3D undo log   ", "x faster", Pentomino3dUndoTest},
+    {"3D wide mask  ", "x faster", Pentomino3dWideTest},
+    {"3D race       ", "x faster", Pentomino3dRaceTest},
+    {"3D checkpoint ", "% time",   Pentomino3dCheckpointTest},
+    {"3D symmetry   ", "x fewer", Pentomino3dSymmetryTest},
+    {"3D setup      ", "ms",      Pentomino3dSetupTest},
+    {"3D full count ", "Mplace/s", Pentomino3dFullCountTest},
+};
+#define NUM_EXTRA_TESTS (int)(sizeof(ExtraTests)/sizeof(ExtraTests[0]))
+#define EXTRA_TESTS_END (EXTRA_TESTS_START+NUM_EXTRA_TESTS)
+
+//----------------------------------------------------------------------------
+// Check if a test number is one that exists.
+//----------------------------------------------------------------------------
+int IsValidTest(int a)
+{
+    if (a < NUM_TESTS) return TRUE;
+    if (a > 10 && a <= 30) return TRUE; // CRC multi
+    if (a >= EXTRA_TESTS_START && a < EXTRA_TESTS_END) return TRUE;
+    return FALSE;
+}
+
 //----------------------------------------------------------------------------
 // Time various routines
 //----------------------------------------------------------------------------
-double TimeFunction(int WhichOne, int * CoresRunOn, uint8_t * buffer, int size)
+double TimeFunction(int WhichOne, int * CoresRunOn, double * Rate, uint8_t * buffer, int size)
 {
     static int crc0=0;
     double duration_sec;
@@ -184,7 +250,7 @@ double TimeFunction(int WhichOne, int * CoresRunOn, uint8_t * buffer, int size)
         if (WhichOne == 4){
             int ret;
             ret = PentominoBenchmark();
-            if (ret != 2339){
+            if (ret != PentominoBoardSolutions()){
                 // 2D Pentomino program malfunctions on Pi with /Ofast
                 printf("Pentomino test malfunctioned\n");
                 Malfunctioned = 1;
@@ -194,6 +260,10 @@ double TimeFunction(int WhichOne, int * CoresRunOn, uint8_t * buffer, int size)
         else
             printf("None");
 
+    }else if (WhichOne >= EXTRA_TESTS_START){
+        *Rate = ExtraTests[WhichOne-EXTRA_TESTS_START].Func();
+        if (*Rate < 0) Malfunctioned = 1;
+
     }else if (WhichOne <= 30){
         // Simultaneous CRC benchmark
         for (iter=0;iter<NumIter;iter++){
@@ -227,11 +297,18 @@ double TimeFunction(int WhichOne, int * CoresRunOn, uint8_t * buffer, int size)
     char strbuf[30];
     if (WhichOne < NUM_TESTS){
         str = Methods[WhichOne];
+    }else if (WhichOne >= EXTRA_TESTS_START){
+        str = ExtraTests[WhichOne-EXTRA_TESTS_START].Name;
     }else{
         sprintf(strbuf,"CRC_MULTI %2d",WhichOne-10);
         str = strbuf;
     }
-    printf("%s, Core %2d-%2d, Time: %6.3f s\n",str,core_start,core_after,duration_sec);
+    if (WhichOne >= EXTRA_TESTS_START){
+        printf("%s, Core %2d-%2d, Time: %6.3f s, %8.3f %s\n",str,core_start,core_after,
+                duration_sec, *Rate, ExtraTests[WhichOne-EXTRA_TESTS_START].Units);
+    }else{
+        printf("%s, Core %2d-%2d, Time: %6.3f s\n",str,core_start,core_after,duration_sec);
+    }
 
     CoresRunOn[0] = core_start;
     CoresRunOn[1] = core_after;
@@ -335,16 +412,18 @@ void * DoTests(void * param)
 
     // Time the different tests
     for (int a=TestStartAt;a<=TestEndAt;a++){
-        if (a<NUM_TESTS || a > 10){
+        if (IsValidTest(a)){
             for (int r=0; r<Repetitions;r++){
-                double time = TimeFunction(a, Parms->CoresRunOn[a],buffer,BufferSize);
-                if (FirstProcessorDone) break; // Abort if another core is done.
+                double rate = 0;
+                double time = TimeFunction(a, Parms->CoresRunOn[a],&rate,buffer,BufferSize);
+                if (QuitOnFirstDone && FirstProcessorDone) break; // Abort if another core is done (-q).
                 Parms->Times[a] += time;
+                Parms->Rates[a] += rate;
                 Parms->NumRuns[a] += 1;
             }
         }
 
-        if (FirstProcessorDone) break; // Abort if another core is done.
+        if (QuitOnFirstDone && FirstProcessorDone) break; // Abort if another core is done (-q).
     }
     if (!FirstProcessorDone)
     FirstProcessorDone = TRUE;
@@ -357,6 +436,49 @@ void * DoTests(void * param)
 }
 
 
+//----------------------------------------------------------------------------
+// Print results of the extra tests.  These report a rate, so for each test
+// also print the total rate over all the threads, grouped by core type.
+//----------------------------------------------------------------------------
+void PrintExtraResults(FILE * outfile)
+{
+    int nres = NumAffinities? NumAffinities : 1;
+    const char * Classes[] = {"P","E","-"};
+
+    fprintf(outfile,"Compiled         ,Computer      ,Test          ,    Time,       Rate,Units,Core,Type\n");
+    for (int a=EXTRA_TESTS_START;a<EXTRA_TESTS_END;a++){
+        ExtraTest_t * Test = &ExtraTests[a-EXTRA_TESTS_START];
+
+        for (int n=0;n<nres;n++){
+            int NumRuns = Parms[n].NumRuns[a];
+            int core = Parms[n].CoresRunOn[a][0];
+            if (!NumRuns) continue;
+            fprintf(outfile,"%s,%s,%8.3f,%11.3f,%-5s,%4d,%s\n",AboutString,Test->Name,
+                    Parms[n].Times[a]/NumRuns, Parms[n].Rates[a]/NumRuns, Test->Units,
+                    core, CoreClass(core));
+        }
+
+        if (nres > 1){
+            for (int c=0;c<3;c++){
+                double Total = 0;
+                int NumThreads = 0;
+                for (int n=0;n<nres;n++){
+                    int NumRuns = Parms[n].NumRuns[a];
+                    if (!NumRuns) continue;
+                    if (strcmp(CoreClass(Parms[n].CoresRunOn[a][0]), Classes[c])) continue;
+                    Total += Parms[n].Rates[a]/NumRuns;
+                    NumThreads += 1;
+                }
+                if (NumThreads){
+                    fprintf(outfile,"%s,%s,%8s,%11.3f,%-5s,%2d thr,%s\n",AboutString,Test->Name,
+                        "total", Total, Test->Units, NumThreads, Classes[c]);
+                }
+            }
+        }
+    }
+    fprintf(outfile,"\n");
+}
+
 //----------------------------------------------------------------------------
 // Print summary of overall results
 //----------------------------------------------------------------------------
@@ -364,7 +486,7 @@ void PrintResults(FILE * outfile)
 {
     int nres = NumAffinities? NumAffinities : 1;
 
-    for (int n=0;n<nres;n++){
+    for (int n=0;n<nres && TestStartAt < EXTRA_TESTS_START;n++){
         double * Times = Parms[n].Times;
         int * NumRuns = Parms[n].NumRuns;
         int (*CoresRunOn)[2] = Parms[n].CoresRunOn;
@@ -395,7 +517,7 @@ void PrintResults(FILE * outfile)
 
         }
 
-        if (TestEndAt > 10){
+        if (TestEndAt > 10 && TestStartAt < EXTRA_TESTS_START){
             fprintf(outfile,"%s,CRCMulti",AboutString);
             // Print the timing results.
             for (int a=0;a<12;a++){
@@ -416,6 +538,8 @@ void PrintResults(FILE * outfile)
         }
         fprintf(outfile,"\n");
     }
+
+    if (TestEndAt >= EXTRA_TESTS_START) PrintExtraResults(outfile);
 }
 
 //----------------------------------------------------------------------------
@@ -437,8 +561,19 @@ void Usage(void)
            "   -q          Abort tests as soon as one core is done.  Useful when\n"
            "               when testing load with reperated test on P cores and E cores\n"
            "               at the same time -- quite whe no longer fully loaded.\n"
+           "   -b[n]       Board shape for pentomino tests 4, 56-61 and 63\n"
+           "   -d[spec]    3D pentomino puzzle for tests 5 and 65-73, as a box size\n"
+           "               like -d6x5x5, or a file with the size and pieces.\n"
 
            );
+    printf("Tests:\n");
+    for (int a=0;a<NUM_TESTS;a++) printf("   %2d %s\n",a,Methods[a]);
+    printf("   11-30 CRC_MULTI, n CRCs at once\n");
+    for (int a=0;a<NUM_EXTRA_TESTS;a++){
+        printf("   %2d %s (%s)\n",a+EXTRA_TESTS_START,ExtraTests[a].Name,ExtraTests[a].Units);
+    }
+    printf("Pentomino boards:\n");
+    for (int a=0;PentominoBoardName(a);a++) printf("   %2d %s\n",a,PentominoBoardName(a));
     exit(-1);
 }
 
@@ -498,6 +633,18 @@ int main(int argc, char *argv[])
                 QuitOnFirstDone = TRUE;
                 break;
 
+            case 'b':
+                if (!PentominoSetBoard(num)){
+                    printf("No pentomino board %d\n",num);
+                    Usage();
+                }
+                printf("Pentomino board %s\n",PentominoBoardName(num));
+                break;
+
+            case 'd':
+                if (!Pento3dSetPuzzle(argv[a]+2)) Usage();
+                break;
+
             default:
                 printf("Argumant '%s' not understoond\n",argv[a]);
                 Usage();
@@ -1,12 +1,135 @@
 typedef unsigned int uint32_t;
 typedef unsigned char uint8_t;
 
+#ifndef thread_local
+    #ifdef _MSC_VER
+        #define thread_local __declspec(thread) 
+    #else
+        #define thread_local __thread
+    #endif
+#endif
+
+// For loops over small arrays of accumulators that must end up in registers.
+#if defined(__GNUC__) && __GNUC__ >= 8
+    #define FULL_UNROLL _Pragma("GCC unroll 16")
+#else
+    #define FULL_UNROLL
+#endif
 
 // pentominos.c
 extern int PentominoBenchmark(void);
+extern int PentominoIterative(void);
+extern int PentominoBitboard(void);
+extern int PentominoTables(void);
+extern double PentominoBytesTest(void);   // These return millions of placements/sec
+extern double PentominoIterativeTest(void);
+extern double PentominoBitsTest(void);
+extern double PentominoTablesTest(void);
+extern int PentominoPruned(void);
+extern double PentominoPruneTest(void);   // Returns speedup from pruning
+
+// Board shapes, for the placement table solver and the ones built on it.
+extern int PentominoSetBoard(int n);
+extern int PentominoBoardNum(void);
+extern const char * PentominoBoardName(int n);
+extern int PentominoBoardSolutions(void);
+extern int PentominoKnownSolutions(int n);
+extern int PentominoBoardDistinct(void);
+
+// Writes every distinct solution as 4 bits per square, returns how many.
+extern int PentominoEnumerate(const char * FileName);
+extern double PentominoEnumTest(void);
+
+// A piece of the 2D pentomino search, for running in parallel.
+typedef struct {
+    unsigned long long Lo, Hi;  // Field with the first pieces placed
+    int Placed, NumPlaced;      // Which pieces those were, and how many
+    int Solutions, Places;      // Results of searching the rest
+}PentoTask_t;
+extern void PentominoTaskSetup(void);
+extern int PentominoSplit(PentoTask_t * Tasks, int MaxTasks, int Depth);
+extern void PentominoRunTask(PentoTask_t * Task);
+
+// A placement as a row of the exact cover problem.
+typedef struct {
+    int Piece;
+    unsigned char Squares[5];
+}PentoRow_t;
+extern int PentominoRows(PentoRow_t * Rows, int MaxRows);
+
+// Piece shapes and board layout, for solvers with their own field.
+typedef struct {
+    int NumVariants;
+    signed char Row[8][4], Col[8][4]; // Other squares, relative to the lowest
+}PentoShape_t;
+extern void PentominoShapes(PentoShape_t * Shapes);
+extern void PentominoBoardSize(int n, int * Width, int * Height);
+extern int PentominoBoardSquare(int n, int x, int y);
+
+// searchstats.c  Per depth statistics for the pentomino searches.  Only
+// collected when compiled with SEARCH_STATS (make STATS=1), as the
+// counting and timing slow the search down.
+#define MAX_STATS_DEPTH 40
+typedef struct {
+    double Nodes;       // Times the search got to this depth
+    double Tries;       // Placements checked
+    double Fits;        // Placements made
+    double Redundant;   // Fit, but not where it was needed
+    double Backtracks;  // Nodes where nothing fit
+    double Seconds;     // Time spent at this depth and below
+}SearchStats_t;
+extern thread_local SearchStats_t SearchStats[MAX_STATS_DEPTH];
+extern void StatsReset(void);
+extern void StatsPrint(const char * Title);
+
+#ifdef SEARCH_STATS
+    #define STATS_ENTER(d)    int StatsDepth_ = (d); int StatsFits_ = 0; \
+                              double StatsStart_ = GetTimeSec(); SearchStats[d].Nodes += 1
+    #define STATS_FIT()       (StatsFits_++, SearchStats[StatsDepth_].Fits += 1)
+    #define STATS_COUNT(what) (SearchStats[StatsDepth_].what += 1)
+    #define STATS_LEAVE()     (SearchStats[StatsDepth_].Backtracks += StatsFits_ ? 0 : 1, \
+                               SearchStats[StatsDepth_].Seconds += GetTimeSec()-StatsStart_)
+    #define STATS_RESET()     StatsReset()
+    #define STATS_PRINT(t)    StatsPrint(t)
+#else
+    #define STATS_ENTER(d)
+    #define STATS_FIT()
+    #define STATS_COUNT(what)
+    #define STATS_LEAVE()
+    #define STATS_RESET()
+    #define STATS_PRINT(t)
+#endif
+
+// pentopar.c  (returns speedup from running on all cores)
+extern double PentominoParallelTest(void);
+
+// The thread pool in pentopar.c, for other searches split into tasks.
+#define POOL_MAX_WORKERS 64
+extern int PoolCores(void);
+extern int RunTaskPool(int NumThreads, int NumTasks, void (*Setup)(void),
+                       void (*Run)(void * Context, int Task, int Worker), void (*Done)(void),
+                       void * Context);
+
+// pentodlx.c  (returns millions of placements/sec)
+extern double PentominoDlxTest(void);
+
+// pentospec.c  (returns speedup of the board specific solvers)
+extern double PentominoSpecTest(void);
 
 // 3d-pentomino.c
 extern int Time3dPentominoSolver(void);
+extern double Pentomino3dBitsTest(void);   // Returns speedup from the bitboard
+extern double Pentomino3dListsTest(void);  // and from the placement lists
+extern double Pentomino3dCountTest(void);  // Millions of placements/sec, all cores
+extern double Pentomino3dUndoTest(void);   // Speedup from the undo log
+extern double Pentomino3dWideTest(void);   // and from the 64 cube fit mask
+extern double Pentomino3dRaceTest(void);   // and from racing on all cores
+extern double Pentomino3dCheckpointTest(void); // Percent of time checkpointing
+extern double Pentomino3dSymmetryTest(void); // Fewer nodes from symmetry breaking
+extern double Pentomino3dSetupTest(void);  // Milliseconds of setup before searching
+extern double Pentomino3dFullCountTest(void); // Millions of placements/sec, counting all
+// Box size as "6x5x5", or a file with the size and pieces.
+extern int Pento3dSetPuzzle(const char * Spec);
 
 // crc_timing.c
 extern void init_crc32_table(void);
@@ -18,3 +141,43 @@ extern unsigned compute_crc32_table(unsigned char  *data, int length, int * zero
 extern unsigned compute_simul_crc32_table(unsigned char *data, unsigned char * data2, int length, int *zerop);
 extern unsigned compute_crc32_simul_n(unsigned char *datap[], int length, int num, uint32_t * crc_ret);
 
+// timing.c
+typedef struct {
+    double Cycles;
+    double Instructions;
+    double BranchMisses;
+}Counters_t;
+
+extern double GetTimeSec(void);
+extern int CurrentCore(void);
+extern const char * CoreClass(int core);
+extern void CountersStart(void);
+extern void CountersRead(Counters_t * Counts);
+extern double EstimateClockHz(void);
+extern double ElapsedCycles(Counters_t * Counts, double Seconds);
+
+// membw.c  (these return GB/s)
+extern double MemBwRead(void);
+extern double MemBwWrite(void);
+extern double MemBwCopy(void);
+extern double MemBwTriad(void);
+extern double MemBwWriteNt(void);
+extern double MemBwCopyNt(void);
+extern double MemBwTriadNt(void);
+
+// branchpred.c  (these return the largest size the predictor still learns)
+extern double BranchPeriodTest(void);
+extern double BranchStaticTest(void);
+extern double BranchHistoryTest(void);
+extern double BranchIndirectTest(void);
+
+// latency.c  (returns number of chains needed for best fp add throughput)
+extern double InstrLatencyTest(void);
+
+// strided_sum.c  (these return best elements per cycle)
+extern double StridedSumInt(void);
+extern double StridedSumFloat(void);
+extern double StridedSumDouble(void);
+
+// compsum.c  (returns how many times slower Kahan summation is than naive)
+extern double CompensatedSumTest(void);
@@ -0,0 +1,40 @@
+//----------------------------------------------------------------------------
+// Statistics on where the pentomino searches spend their effort, by depth
+// in the search tree.  The solvers only collect them when compiled with
+// SEARCH_STATS, see the STATS_ macros in perftest.h.
+//----------------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include "perftest.h"
+
+thread_local SearchStats_t SearchStats[MAX_STATS_DEPTH];
+
+//----------------------------------------------------------------------------
+// Clear the statistics, before a run.
+//----------------------------------------------------------------------------
+void StatsReset(void)
+{
+    memset(SearchStats, 0, sizeof(SearchStats));
+}
+
+//----------------------------------------------------------------------------
+// Print the statistics as a table, one line per depth.  Rejects are the
+// placements checked that didn't fit.  Time is for that depth and all
+// the ones below it, so the first line is the whole search.
+//----------------------------------------------------------------------------
+void StatsPrint(const char * Title)
+{
+    double Total = SearchStats[0].Seconds;
+    int d;
+
+    printf("Search statistics, %s\n", Title);
+    printf("depth,      nodes,      tries,    rejects,       fits,  redundant, backtracks,  time (s), time %%\n");
+    for (d=0;d<MAX_STATS_DEPTH;d++){
+        SearchStats_t * s = &SearchStats[d];
+        if (s->Nodes == 0) continue;
+        printf("%5d,%11.0f,%11.0f,%11.0f,%11.0f,%11.0f,%11.0f,%10.3f,%6.1f\n", d,
+                s->Nodes, s->Tries, s->Tries - s->Fits - s->Redundant, s->Fits,
+                s->Redundant, s->Backtracks, s->Seconds,
+                Total > 0 ? s->Seconds * 100 / Total : 0);
+    }
+}
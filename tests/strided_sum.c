@@ -0,0 +1,318 @@
+//----------------------------------------------------------------------------
+// Test exploring strided summation vs straight up summation.
+// Performance substantially better for strided as it allows CPU ipipelining
+// to do more in parallel before needing result of previous operation.
+//
+// The sum of squares is generated for 1 to 16 accumulators, for int, float
+// and double elements, plus an explicitly vectorized version.
+//
+// Compiled without vectorizing or reassociating, so the compiler doesn't
+// add accumulators of its own.
+//
+// Matthias wandel April 2025
+//----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "perftest.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define HAVE_SSE2 1
+#elif defined(__aarch64__)
+    #include <arm_neon.h>
+    #define HAVE_NEON 1
+#endif
+
+#define NUM_ELEMENTS 100000
+#define NUM_PASSES 200
+#define MAX_ACCUMULATORS 16
+
+typedef long long sum_int_t;
+
+static thread_local int * IntArray;
+static thread_local float * FloatArray;
+static thread_local double * DoubleArray;
+volatile double StridedSink;
+
+//----------------------------------------------------------------------------
+// Random-ish data, ints between -3 and +3, floats between -1 and +1
+//----------------------------------------------------------------------------
+static void FillArrays(void)
+{
+    unsigned r = 12345;
+    int i;
+    if (IntArray) return;
+    IntArray = (int *)malloc(NUM_ELEMENTS*sizeof(int));
+    FloatArray = (float *)malloc(NUM_ELEMENTS*sizeof(float));
+    DoubleArray = (double *)malloc(NUM_ELEMENTS*sizeof(double));
+    if (!IntArray || !FloatArray || !DoubleArray){
+        printf("Failed to allocate summation arrays\n");
+        exit(-1);
+    }
+    for (i=0;i<NUM_ELEMENTS;i++){
+        r = r * 1103515245 + 12345;
+        IntArray[i] = (int)((r >> 16) % 7) - 3;
+        FloatArray[i] = (float)((r >> 8) & 0xffff) / 32768.0f - 1.0f;
+        DoubleArray[i] = FloatArray[i];
+    }
+}
+
+//----------------------------------------------------------------------------
+// Sum into N bins, elements i, i+N, i+2N... going into the same bin.
+//----------------------------------------------------------------------------
+#define SUM_KERNEL(NAME, ELTYPE, SUMTYPE, N)                            \
+static SUMTYPE NAME##N(const ELTYPE * arr, int size)                    \
+{                                                                       \
+    SUMTYPE total[N];                                                   \
+    SUMTYPE sum = 0;                                                    \
+    int i, k;                                                           \
+    FULL_UNROLL                                                         \
+    for (k=0;k<N;k++) total[k] = 0;                                     \
+    for (i=0;i+N<=size;i+=N){                                           \
+        FULL_UNROLL                                                     \
+        for (k=0;k<N;k++) total[k] += arr[i+k] * arr[i+k];              \
+    }                                                                   \
+    for (;i<size;i++) total[0] += arr[i] * arr[i];                      \
+    FULL_UNROLL                                                         \
+    for (k=0;k<N;k++) sum += total[k];                                  \
+    return sum;                                                         \
+}
+
+#define SUM_KERNELS(NAME, ELTYPE, SUMTYPE)                              \
+    SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 1)  SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 2)  \
+    SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 3)  SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 4)  \
+    SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 5)  SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 6)  \
+    SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 7)  SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 8)  \
+    SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 9)  SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 10) \
+    SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 11) SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 12) \
+    SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 13) SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 14) \
+    SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 15) SUM_KERNEL(NAME, ELTYPE, SUMTYPE, 16)
+
+#define SUM_KERNEL_LIST(NAME) {NAME##1, NAME##2, NAME##3, NAME##4, NAME##5, NAME##6, \
+        NAME##7, NAME##8, NAME##9, NAME##10, NAME##11, NAME##12, NAME##13, NAME##14, \
+        NAME##15, NAME##16}
+
+// Like the original program, squares are done in the element type and
+// summed into the wider type.
+SUM_KERNELS(SumInt, int, sum_int_t)
+SUM_KERNELS(SumFloat, float, double)
+SUM_KERNELS(SumDouble, double, double)
+
+typedef sum_int_t (*IntSum_t)(const int * arr, int size);
+typedef double (*FloatSum_t)(const float * arr, int size);
+typedef double (*DoubleSum_t)(const double * arr, int size);
+
+static const IntSum_t IntSums[MAX_ACCUMULATORS] = SUM_KERNEL_LIST(SumInt);
+static const FloatSum_t FloatSums[MAX_ACCUMULATORS] = SUM_KERNEL_LIST(SumFloat);
+static const DoubleSum_t DoubleSums[MAX_ACCUMULATORS] = SUM_KERNEL_LIST(SumDouble);
+
+//----------------------------------------------------------------------------
+// Explicit SIMD versions, with four vector accumulators.
+//----------------------------------------------------------------------------
+#ifdef HAVE_SSE2
+static sum_int_t SumIntSimd(const int * arr, int size)
+{
+    __m128i t0 = _mm_setzero_si128(), t1 = t0;
+    sum_int_t Lanes[2];
+    int i;
+    for (i=0;i+4<=size;i+=4){
+        // SSE2 only multiplies unsigned, so square the absolute values.
+        __m128i v = _mm_loadu_si128((const __m128i *)(arr+i));
+        __m128i sign = _mm_srai_epi32(v, 31);
+        v = _mm_sub_epi32(_mm_xor_si128(v, sign), sign);
+        t0 = _mm_add_epi64(t0, _mm_mul_epu32(v, v));
+        v = _mm_srli_epi64(v, 32);
+        t1 = _mm_add_epi64(t1, _mm_mul_epu32(v, v));
+    }
+    _mm_storeu_si128((__m128i *)Lanes, _mm_add_epi64(t0, t1));
+    for (;i<size;i++) Lanes[0] += arr[i] * arr[i];
+    return Lanes[0] + Lanes[1];
+}
+
+static double SumFloatSimd(const float * arr, int size)
+{
+    __m128d t0 = _mm_setzero_pd(), t1 = t0, t2 = t0, t3 = t0;
+    double Lanes[2];
+    int i;
+    for (i=0;i+8<=size;i+=8){
+        __m128 v0 = _mm_loadu_ps(arr+i);
+        __m128 v1 = _mm_loadu_ps(arr+i+4);
+        v0 = _mm_mul_ps(v0, v0);
+        v1 = _mm_mul_ps(v1, v1);
+        t0 = _mm_add_pd(t0, _mm_cvtps_pd(v0));
+        t1 = _mm_add_pd(t1, _mm_cvtps_pd(_mm_movehl_ps(v0, v0)));
+        t2 = _mm_add_pd(t2, _mm_cvtps_pd(v1));
+        t3 = _mm_add_pd(t3, _mm_cvtps_pd(_mm_movehl_ps(v1, v1)));
+    }
+    _mm_storeu_pd(Lanes, _mm_add_pd(_mm_add_pd(t0, t1), _mm_add_pd(t2, t3)));
+    for (;i<size;i++) Lanes[0] += arr[i] * arr[i];
+    return Lanes[0] + Lanes[1];
+}
+
+static double SumDoubleSimd(const double * arr, int size)
+{
+    __m128d t0 = _mm_setzero_pd(), t1 = t0, t2 = t0, t3 = t0;
+    double Lanes[2];
+    int i;
+    for (i=0;i+8<=size;i+=8){
+        __m128d v0 = _mm_loadu_pd(arr+i);
+        __m128d v1 = _mm_loadu_pd(arr+i+2);
+        __m128d v2 = _mm_loadu_pd(arr+i+4);
+        __m128d v3 = _mm_loadu_pd(arr+i+6);
+        t0 = _mm_add_pd(t0, _mm_mul_pd(v0, v0));
+        t1 = _mm_add_pd(t1, _mm_mul_pd(v1, v1));
+        t2 = _mm_add_pd(t2, _mm_mul_pd(v2, v2));
+        t3 = _mm_add_pd(t3, _mm_mul_pd(v3, v3));
+    }
+    _mm_storeu_pd(Lanes, _mm_add_pd(_mm_add_pd(t0, t1), _mm_add_pd(t2, t3)));
+    for (;i<size;i++) Lanes[0] += arr[i] * arr[i];
+    return Lanes[0] + Lanes[1];
+}
+#define SIMD_NAME "SSE2"
+
+#elif defined(HAVE_NEON)
+static sum_int_t SumIntSimd(const int * arr, int size)
+{
+    int64x2_t t0 = vdupq_n_s64(0), t1 = t0;
+    sum_int_t sum;
+    int i;
+    for (i=0;i+4<=size;i+=4){
+        int32x4_t v = vld1q_s32(arr+i);
+        t0 = vmlal_s32(t0, vget_low_s32(v), vget_low_s32(v));
+        t1 = vmlal_high_s32(t1, v, v);
+    }
+    sum = vaddvq_s64(vaddq_s64(t0, t1));
+    for (;i<size;i++) sum += arr[i] * arr[i];
+    return sum;
+}
+
+static double SumFloatSimd(const float * arr, int size)
+{
+    float64x2_t t0 = vdupq_n_f64(0), t1 = t0, t2 = t0, t3 = t0;
+    double sum;
+    int i;
+    for (i=0;i+8<=size;i+=8){
+        float32x4_t v0 = vld1q_f32(arr+i);
+        float32x4_t v1 = vld1q_f32(arr+i+4);
+        v0 = vmulq_f32(v0, v0);
+        v1 = vmulq_f32(v1, v1);
+        t0 = vaddq_f64(t0, vcvt_f64_f32(vget_low_f32(v0)));
+        t1 = vaddq_f64(t1, vcvt_high_f64_f32(v0));
+        t2 = vaddq_f64(t2, vcvt_f64_f32(vget_low_f32(v1)));
+        t3 = vaddq_f64(t3, vcvt_high_f64_f32(v1));
+    }
+    sum = vaddvq_f64(vaddq_f64(vaddq_f64(t0, t1), vaddq_f64(t2, t3)));
+    for (;i<size;i++) sum += arr[i] * arr[i];
+    return sum;
+}
+
+static double SumDoubleSimd(const double * arr, int size)
+{
+    float64x2_t t0 = vdupq_n_f64(0), t1 = t0, t2 = t0, t3 = t0;
+    double sum;
+    int i;
+    for (i=0;i+8<=size;i+=8){
+        t0 = vfmaq_f64(t0, vld1q_f64(arr+i),   vld1q_f64(arr+i));
+        t1 = vfmaq_f64(t1, vld1q_f64(arr+i+2), vld1q_f64(arr+i+2));
+        t2 = vfmaq_f64(t2, vld1q_f64(arr+i+4), vld1q_f64(arr+i+4));
+        t3 = vfmaq_f64(t3, vld1q_f64(arr+i+6), vld1q_f64(arr+i+6));
+    }
+    sum = vaddvq_f64(vaddq_f64(vaddq_f64(t0, t1), vaddq_f64(t2, t3)));
+    for (;i<size;i++) sum += arr[i] * arr[i];
+    return sum;
+}
+#define SIMD_NAME "NEON"
+
+#else
+// No vector instructions on this build, so use the 4 accumulator version.
+#define SumIntSimd SumInt4
+#define SumFloatSimd SumFloat4
+#define SumDoubleSimd SumDouble4
+#define SIMD_NAME "none"
+#endif
+
+//----------------------------------------------------------------------------
+// Elements per cycle for summing one way.  Which array and kernel to use is
+// given by the element type, as only one of the kernel pointers is set.
+//----------------------------------------------------------------------------
+static double ElementsPerCycle(IntSum_t IntSum, FloatSum_t FloatSum,
+                               DoubleSum_t DoubleSum, double * Result)
+{
+    Counters_t Counts;
+    double start, Cycles;
+    double sum = 0;
+    int p;
+
+    CountersStart();
+    start = GetTimeSec();
+    for (p=0;p<NUM_PASSES;p++){
+        if (IntSum) sum = (double)IntSum(IntArray, NUM_ELEMENTS);
+        if (FloatSum) sum = FloatSum(FloatArray, NUM_ELEMENTS);
+        if (DoubleSum) sum = DoubleSum(DoubleArray, NUM_ELEMENTS);
+    }
+    start = GetTimeSec()-start;
+    CountersRead(&Counts);
+    Cycles = ElapsedCycles(&Counts, start);
+
+    StridedSink = sum;
+    *Result = sum;
+    return (double)NUM_ELEMENTS * NUM_PASSES / Cycles;
+}
+
+//----------------------------------------------------------------------------
+// Run all the accumulator counts for one element type.  Returns the best
+// elements per cycle, or -1 if the sums don't agree.
+//----------------------------------------------------------------------------
+#define ELEMENT_INT 0
+#define ELEMENT_FLOAT 1
+#define ELEMENT_DOUBLE 2
+
+static double StridedSumTest(int ElementType)
+{
+    static const char * TypeNames[] = {"int", "float", "double"};
+    double Rate, Best = 0, Sum, FirstSum = 0;
+    int core = CurrentCore();
+    int Malfunctioned = 0;
+    int a;
+
+    FillArrays();
+    printf("Sum of squares, %s elements, core %d (%s)\n",TypeNames[ElementType],
+            core, CoreClass(core));
+    printf("  accumulators  elements/cycle  sum\n");
+
+    for (a=0;a<=MAX_ACCUMULATORS;a++){
+        // Last one around is the vectorized one.
+        int Simd = a == MAX_ACCUMULATORS;
+        switch(ElementType){
+            case ELEMENT_INT:
+                Rate = ElementsPerCycle(Simd ? SumIntSimd : IntSums[a], NULL, NULL, &Sum);
+                break;
+            case ELEMENT_FLOAT:
+                Rate = ElementsPerCycle(NULL, Simd ? SumFloatSimd : FloatSums[a], NULL, &Sum);
+                break;
+            default:
+                Rate = ElementsPerCycle(NULL, NULL, Simd ? SumDoubleSimd : DoubleSums[a], &Sum);
+                break;
+        }
+        if (Simd){
+            printf("  %12s  %14.3f  %.6f\n", SIMD_NAME, Rate, Sum);
+        }else{
+            printf("  %12d  %14.3f  %.6f\n", a+1, Rate, Sum);
+        }
+
+        // Order of adding changes the rounding, but only a little.
+        if (a == 0) FirstSum = Sum;
+        if (fabs(Sum-FirstSum) > 1e-9*fabs(FirstSum)) Malfunctioned = 1;
+        if (Rate > Best) Best = Rate;
+    }
+    if (Malfunctioned){
+        printf("Sums don't match!\n");
+        return -1;
+    }
+    return Best;
+}
+
+double StridedSumInt(void)    { return StridedSumTest(ELEMENT_INT); }
+double StridedSumFloat(void)  { return StridedSumTest(ELEMENT_FLOAT); }
+double StridedSumDouble(void) { return StridedSumTest(ELEMENT_DOUBLE); }
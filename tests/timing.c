@@ -0,0 +1,251 @@
+//----------------------------------------------------------------------------
+// Timing and core identification helpers shared by the benchmark modules.
+//----------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#if _WIN32 || _WIN64
+    #define _WINDOWS 1
+#else
+    #define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WINDOWS
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <sched.h>
+    #include <unistd.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <linux/perf_event.h>
+    #define HAVE_PERF_EVENTS 1
+#endif
+#include "perftest.h"
+
+volatile unsigned ClockSink;
+
+//----------------------------------------------------------------------------
+// Seconds from some arbitrary starting point, for timing inside a test.
+//----------------------------------------------------------------------------
+double GetTimeSec(void)
+{
+#ifdef _WINDOWS
+    LARGE_INTEGER freq_t, now_t;
+    QueryPerformanceFrequency(&freq_t);
+    QueryPerformanceCounter(&now_t);
+    return (double)now_t.QuadPart / freq_t.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Core the calling thread is running on, or -1 if we can't tell.
+//----------------------------------------------------------------------------
+int CurrentCore(void)
+{
+#ifdef _WINDOWS
+  #if _MSC_VER > 0 && _MSC_VER < 1300
+    return -1;
+  #else
+    return GetCurrentProcessorNumber();
+  #endif
+#elif defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+#ifndef _WINDOWS
+//----------------------------------------------------------------------------
+// Check if a core appears in a linux cpu list file, like "0-7,16,18-19"
+//----------------------------------------------------------------------------
+static int CoreInListFile(const char * FileName, int core)
+{
+    char List[256];
+    char * p;
+    FILE * fp = fopen(FileName, "r");
+    if (!fp) return -1;
+    if (!fgets(List, sizeof(List), fp)) List[0] = '\0';
+    fclose(fp);
+
+    p = List;
+    while (*p >= '0' && *p <= '9'){
+        int first, last;
+        first = last = (int)strtol(p, &p, 10);
+        if (*p == '-') last = (int)strtol(p+1, &p, 10);
+        if (core >= first && core <= last) return 1;
+        if (*p != ',') break;
+        p++;
+    }
+    return 0;
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Classify a core as performance ("P") or efficiency ("E") core, so results
+// from hybrid CPUs can be grouped.  Returns "-" when the CPU is not hybrid,
+// or we can't tell.
+//----------------------------------------------------------------------------
+const char * CoreClass(int core)
+{
+#ifdef _WINDOWS
+  #if _MSC_VER >= 1900
+    // Windows 10 and later report an efficiency class per logical processor.
+    static char Buffer[64*1024];
+    ULONG Len = sizeof(Buffer);
+    SYSTEM_CPU_SET_INFORMATION * Info;
+    int MaxClass = 0, CoreClassNum = -1;
+    ULONG Offset;
+
+    if (!GetSystemCpuSetInformation((PSYSTEM_CPU_SET_INFORMATION)Buffer, Len, &Len, GetCurrentProcess(), 0)){
+        return "-";
+    }
+    for (Offset=0;Offset<Len;Offset += Info->Size){
+        Info = (SYSTEM_CPU_SET_INFORMATION *)(Buffer+Offset);
+        if (Info->Type != CpuSetInformation) continue;
+        if (Info->CpuSet.EfficiencyClass > MaxClass) MaxClass = Info->CpuSet.EfficiencyClass;
+        if (Info->CpuSet.LogicalProcessorIndex == core) CoreClassNum = Info->CpuSet.EfficiencyClass;
+    }
+    if (MaxClass == 0 || CoreClassNum < 0) return "-";
+    return CoreClassNum == MaxClass ? "P" : "E";
+  #else
+    return "-";
+  #endif
+#else
+    char FileName[100];
+    int Capacity = 0, MinCapacity = 1024;
+    int a;
+    FILE * fp;
+
+    if (core < 0) return "-";
+
+    // Intel hybrid CPUs list the cores of each type.
+    if (CoreInListFile("/sys/devices/cpu_atom/cpus", core) == 1) return "E";
+    if (CoreInListFile("/sys/devices/cpu_core/cpus", core) == 1) return "P";
+
+    // ARM big.LITTLE reports capacity relative to the biggest core, which is 1024
+    for (a=0;;a++){
+        int Cap = 0;
+        sprintf(FileName, "/sys/devices/system/cpu/cpu%d/cpu_capacity", a);
+        fp = fopen(FileName, "r");
+        if (!fp) break;
+        if (fscanf(fp, "%d", &Cap) != 1) Cap = 0;
+        fclose(fp);
+        if (a == core) Capacity = Cap;
+        if (Cap < MinCapacity) MinCapacity = Cap;
+    }
+    if (Capacity <= 0 || MinCapacity >= 1024) return "-"; // Not big.LITTLE
+    return Capacity >= 1024 ? "P" : "E";
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Hardware counters for the calling thread, where the OS lets us have them.
+// On linux, perf_event_paranoid must be 2 or less.
+//----------------------------------------------------------------------------
+#ifdef HAVE_PERF_EVENTS
+#define NUM_COUNTERS 3
+static thread_local int CounterFds[NUM_COUNTERS];
+static thread_local int CountersOpened;
+static thread_local long long CounterStart[NUM_COUNTERS];
+
+static long long ReadCounter(int n)
+{
+    long long Value = 0;
+    if (CounterFds[n] < 0) return 0;
+    if (read(CounterFds[n], &Value, sizeof(Value)) != sizeof(Value)) return 0;
+    return Value;
+}
+#endif
+
+void CountersStart(void)
+{
+#ifdef HAVE_PERF_EVENTS
+    static const int Events[NUM_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES};
+    int n;
+
+    if (!CountersOpened){
+        for (n=0;n<NUM_COUNTERS;n++){
+            struct perf_event_attr Attr;
+            memset(&Attr, 0, sizeof(Attr));
+            Attr.type = PERF_TYPE_HARDWARE;
+            Attr.size = sizeof(Attr);
+            Attr.config = Events[n];
+            Attr.exclude_kernel = 1;
+            Attr.exclude_hv = 1;
+            CounterFds[n] = (int)syscall(__NR_perf_event_open, &Attr, 0, -1, -1, 0);
+        }
+        CountersOpened = 1;
+    }
+    for (n=0;n<NUM_COUNTERS;n++) CounterStart[n] = ReadCounter(n);
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Counts since CountersStart.  Counts that are not available are set to -1
+//----------------------------------------------------------------------------
+void CountersRead(Counters_t * Counts)
+{
+#ifdef HAVE_PERF_EVENTS
+    if (CountersOpened){
+        double * Out[NUM_COUNTERS];
+        int n;
+        Out[0] = &Counts->Cycles;
+        Out[1] = &Counts->Instructions;
+        Out[2] = &Counts->BranchMisses;
+        for (n=0;n<NUM_COUNTERS;n++){
+            *Out[n] = CounterFds[n] < 0 ? -1 : (double)(ReadCounter(n) - CounterStart[n]);
+        }
+        return;
+    }
+#endif
+    Counts->Cycles = -1;
+    Counts->Instructions = -1;
+    Counts->BranchMisses = -1;
+}
+
+//----------------------------------------------------------------------------
+// Estimate the core clock by timing a dependency chain of adds and xors,
+// which take one cycle each on anything we'd run this on.  Compilers can't
+// fold this chain, so it needs no tricks to keep it honest.
+//----------------------------------------------------------------------------
+double EstimateClockHz(void)
+{
+    const int NumIter = 4000000;
+    unsigned x = 1, y = 3;
+    double start, Best = 1e9;
+    int i, r;
+
+    for (r=0;r<3;r++){
+        start = GetTimeSec();
+        for (i=0;i<NumIter;i++){
+            x += y; y ^= x;
+            x += y; y ^= x;
+            x += y; y ^= x;
+            x += y; y ^= x;
+        }
+        start = GetTimeSec()-start;
+        if (start < Best) Best = start;
+    }
+    ClockSink = x+y;
+    return NumIter * 8.0 / Best;
+}
+
+//----------------------------------------------------------------------------
+// Core clock cycles for a timed section.  From the cycle counter if we have
+// it, otherwise estimated from the time and the clock speed.
+//----------------------------------------------------------------------------
+double ElapsedCycles(Counters_t * Counts, double Seconds)
+{
+    static thread_local double ClockHz;
+    if (Counts->Cycles >= 0) return Counts->Cycles;
+    if (ClockHz == 0) ClockHz = EstimateClockHz();
+    return Seconds * ClockHz;
+}